@@ -1,6 +1,19 @@
+#include "../../common/fixed.h"
+#include "../../common/metrics.h"
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <utility>
 #include <vector>
 
+// Run metrics, exported at the end of main
+std::uint64_t &wfgEdges = metrics::counter("cddd_wfg_edges_total");
+std::uint64_t &dfsVisited = metrics::counter("cddd_dfs_nodes_visited_total");
+std::uint64_t &reducedProcs = metrics::counter("cddd_reduced_processes_total");
+std::uint64_t &satisfiedGroups = metrics::counter("cddd_satisfied_or_groups_total");
+metrics::Histogram &detectLatency = metrics::histogram("cddd_detect_ns");
+metrics::Histogram &reduceLatency = metrics::histogram("cddd_reduce_ns");
+
 // WFG
 void buildGraph(const std::vector<std::vector<int>> &procWait, const std::vector<int> &resOwner,
                 std::vector<std::vector<int>> &graph)
@@ -20,6 +33,7 @@ void buildGraph(const std::vector<std::vector<int>> &procWait, const std::vector
             {
                 int owner = resOwner[j];
                 graph[i][owner] = 1;
+                wfgEdges++;
             }
         }
     }
@@ -31,6 +45,7 @@ bool dfsCycle(int u, const std::vector<std::vector<int>> &graph, std::vector<boo
 {
     visited[u] = true;
     recStack[u] = true;
+    dfsVisited++;
 
     for (size_t v = 0; v < graph[u].size(); ++v)
     {
@@ -54,6 +69,7 @@ bool dfsCycle(int u, const std::vector<std::vector<int>> &graph, std::vector<boo
 // Check if cycle exists in graph
 bool hasDeadlock(const std::vector<std::vector<int>> &graph)
 {
+    metrics::ScopedTimer timer(detectLatency);
     std::size_t nProcs = graph.size();
     std::vector<bool> visited(nProcs, false);
     std::vector<bool> recStack(nProcs, false);
@@ -69,6 +85,143 @@ bool hasDeadlock(const std::vector<std::vector<int>> &graph)
     return false;
 }
 
+// Fixed-size variant: WFG rows are bit sets built straight from proc_wait
+template <int Cap>
+bool detectDeadlockFixed(const std::vector<std::vector<int>> &procWait, const std::vector<int> &resOwner)
+{
+    metrics::ScopedTimer timer(detectLatency);
+    std::array<fixed::BitRow<Cap>, Cap> graph;
+    const std::size_t nProcs = procWait.size();
+    for (std::size_t i = 0; i < nProcs; ++i)
+    {
+        for (std::size_t j = 0; j < resOwner.size(); ++j)
+        {
+            if (procWait[i][j] && resOwner[j] != -1)
+            {
+                graph[i].set(resOwner[j]);
+                wfgEdges++;
+            }
+        }
+    }
+
+    return fixed::findCycle<Cap>(graph, static_cast<int>(nProcs), dfsVisited) >= 0;
+}
+
+// Smallest fixed-size specialization that fits, generic matrix path beyond that
+bool detectDeadlock(const std::vector<std::vector<int>> &procWait, const std::vector<int> &resOwner)
+{
+    bool deadlock = false;
+    auto run = [&](auto cap) {
+        constexpr int Cap = decltype(cap)::value;
+        deadlock = detectDeadlockFixed<Cap>(procWait, resOwner);
+    };
+    if (!fixed::dispatch(static_cast<int>(procWait.size()), run))
+    {
+        std::vector<std::vector<int>> graph(procWait.size(), std::vector<int>(procWait.size()));
+        buildGraph(procWait, resOwner, graph);
+        deadlock = hasDeadlock(graph);
+    }
+    return deadlock;
+}
+
+// AND-OR model: a process waits until every OR-group of its request is satisfied,
+// a group is satisfied by `units` instances of any single resource from the group
+struct ResourceRequest
+{
+    int res;   // resource ID
+    int units; // instances needed
+};
+using OrGroup = std::vector<ResourceRequest>;
+
+// Graph reduction with resource multiplicities
+// Groups of one process must name disjoint resources (main rejects anything else),
+// so every group can be checked on its own against the free instances
+// Returns IDs of processes that can never be reduced (deadlocked)
+std::vector<int> findDeadlocked(const std::vector<int> &units, const std::vector<std::vector<int>> &alloc,
+                                const std::vector<std::vector<OrGroup>> &requests)
+{
+    metrics::ScopedTimer timer(reduceLatency);
+    std::size_t nProcs = alloc.size();
+    std::size_t nRess = units.size();
+
+    // Free instances of each resource
+    std::vector<int> available(units);
+    for (std::size_t i = 0; i < nProcs; ++i)
+        for (std::size_t j = 0; j < nRess; ++j)
+            available[j] -= alloc[i][j];
+
+    // Flatten groups: groupOwner[g] = process, pending[p] = unsatisfied groups of p
+    std::vector<int> groupOwner;
+    std::vector<bool> groupDone;
+    std::vector<int> pending(nProcs, 0);
+    // watchers[r] = (units, group) request edges still waiting on resource r
+    std::vector<std::vector<std::pair<int, int>>> watchers(nRess);
+
+    for (std::size_t i = 0; i < nProcs; ++i)
+    {
+        for (const OrGroup &group : requests[i])
+        {
+            int g = static_cast<int>(groupOwner.size());
+            groupOwner.push_back(static_cast<int>(i));
+            groupDone.push_back(false);
+            for (const ResourceRequest &rq : group)
+            {
+                if (rq.units <= available[rq.res])
+                    groupDone[g] = true;
+                else
+                    watchers[rq.res].emplace_back(rq.units, g);
+            }
+            if (!groupDone[g])
+                pending[i]++;
+        }
+    }
+
+    // Sort waiting edges by demand, so each one is visited once when resource frees up
+    std::vector<std::size_t> cursor(nRess, 0);
+    for (auto &w : watchers)
+        std::sort(w.begin(), w.end());
+
+    std::vector<int> worklist;
+    std::vector<bool> reduced(nProcs, false);
+    for (std::size_t i = 0; i < nProcs; ++i)
+        if (pending[i] == 0)
+            worklist.push_back(static_cast<int>(i));
+
+    while (!worklist.empty())
+    {
+        int p = worklist.back();
+        worklist.pop_back();
+        reduced[p] = true;
+        reducedProcs++;
+
+        // Reduced process finishes and releases everything it holds
+        for (std::size_t j = 0; j < nRess; ++j)
+        {
+            if (alloc[p][j] == 0)
+                continue;
+            available[j] += alloc[p][j];
+
+            auto &w = watchers[j];
+            while (cursor[j] < w.size() && w[cursor[j]].first <= available[j])
+            {
+                int g = w[cursor[j]++].second;
+                if (groupDone[g])
+                    continue;
+                groupDone[g] = true;
+                satisfiedGroups++;
+                if (--pending[groupOwner[g]] == 0)
+                    worklist.push_back(groupOwner[g]);
+            }
+        }
+    }
+
+    std::vector<int> deadlocked;
+    for (std::size_t i = 0; i < nProcs; ++i)
+        if (!reduced[i])
+            deadlocked.push_back(static_cast<int>(i));
+    return deadlocked;
+}
+
 int main()
 {
     int nProcs, nRess;
@@ -95,11 +248,135 @@ int main()
         std::cin >> res_owner[j];
     }
 
-    // Expectations graph
-    std::vector<std::vector<int>> graph(nProcs, std::vector<int>(nProcs));
-    buildGraph(proc_wait, res_owner, graph);
-
-    // Deadlock detection
-    bool deadlock = hasDeadlock(graph);
+    // Expectations graph and deadlock detection
+    bool deadlock = detectDeadlock(proc_wait, res_owner);
     std::cout << (deadlock ? "Deadlock detected!" : "No deadlock.") << std::endl;
+
+    // Benchmark repetitions run after the export so they stay out of the counters
+    auto exportAndBenchmark = [&] {
+        metrics::exportFromEnv();
+        if (int reps = fixed::benchRepetitions())
+        {
+            double genericUs = fixed::benchMicros(reps, [&] {
+                std::vector<std::vector<int>> graph(nProcs, std::vector<int>(nProcs));
+                buildGraph(proc_wait, res_owner, graph);
+                hasDeadlock(graph);
+            });
+            double fixedUs = fixed::benchMicros(reps, [&] { detectDeadlock(proc_wait, res_owner); });
+            fixed::report("WFG build + cycle detection", nProcs, reps, genericUs, fixedUs);
+        }
+    };
+
+    // Optional AND-OR check with multi-instance resources
+    int andOr = 0;
+    std::cout << "Check AND-OR model with resource multiplicities? (0/1): ";
+    std::cin >> andOr;
+    if (andOr != 1)
+    {
+        exportAndBenchmark();
+        return 0;
+    }
+
+    std::vector<int> units(nRess);
+    std::cout << "Enter number of instances of each resource:\n";
+    for (int j = 0; j < nRess; ++j)
+    {
+        std::cin >> units[j];
+        if (units[j] < 0)
+        {
+            std::cerr << "Invalid number of instances of resource " << j << ": " << units[j] << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<int>> alloc(nProcs, std::vector<int>(nRess));
+    std::vector<int> held(nRess, 0);
+    std::cout << "Enter allocation matrix alloc (instances held):\n";
+    for (int i = 0; i < nProcs; ++i)
+    {
+        for (int j = 0; j < nRess; ++j)
+        {
+            std::cin >> alloc[i][j];
+            if (alloc[i][j] < 0)
+            {
+                std::cerr << "Invalid allocation of resource " << j << " to P" << i << ": " << alloc[i][j] << "\n";
+                return 1;
+            }
+            held[j] += alloc[i][j];
+        }
+    }
+    for (int j = 0; j < nRess; ++j)
+    {
+        if (held[j] > units[j])
+        {
+            std::cerr << "Resource " << j << " allocated beyond its instances.\n";
+            return 1;
+        }
+    }
+
+    // Each group: k followed by k pairs 'resource instances'
+    // A resource may appear in only one group of a process, otherwise the AND-composed
+    // groups could all count the same free instances
+    std::vector<std::vector<OrGroup>> requests(nProcs);
+    std::vector<int> groupOfRes(nRess);
+    std::cout << "For each process enter number of OR-groups, then each group as 'k r1 n1 ... rk nk':\n";
+    for (int i = 0; i < nProcs; ++i)
+    {
+        int nGroups;
+        std::cin >> nGroups;
+        if (nGroups < 0)
+        {
+            std::cerr << "Invalid number of OR-groups for P" << i << ": " << nGroups << "\n";
+            return 1;
+        }
+        requests[i].resize(nGroups);
+        std::fill(groupOfRes.begin(), groupOfRes.end(), -1);
+        for (int g = 0; g < nGroups; ++g)
+        {
+            OrGroup &group = requests[i][g];
+            int k;
+            std::cin >> k;
+            if (k < 1)
+            {
+                // An empty OR-group could never be satisfied
+                std::cerr << "Invalid OR-group size for P" << i << ": " << k << "\n";
+                return 1;
+            }
+            group.resize(k);
+            for (ResourceRequest &rq : group)
+            {
+                std::cin >> rq.res >> rq.units;
+                if (rq.res < 0 || rq.res >= nRess)
+                {
+                    std::cerr << "Invalid resource ID: " << rq.res << "\n";
+                    return 1;
+                }
+                if (rq.units <= 0)
+                {
+                    std::cerr << "Invalid number of instances requested: " << rq.units << "\n";
+                    return 1;
+                }
+                if (groupOfRes[rq.res] != -1 && groupOfRes[rq.res] != g)
+                {
+                    std::cerr << "Resource " << rq.res << " appears in more than one OR-group of P" << i << "\n";
+                    return 1;
+                }
+                groupOfRes[rq.res] = g;
+            }
+        }
+    }
+
+    std::vector<int> deadlocked = findDeadlocked(units, alloc, requests);
+    if (deadlocked.empty())
+    {
+        std::cout << "No deadlock (AND-OR model)." << std::endl;
+    }
+    else
+    {
+        std::cout << "Deadlocked processes:";
+        for (int p : deadlocked)
+            std::cout << " P" << p;
+        std::cout << std::endl;
+    }
+    exportAndBenchmark();
 }
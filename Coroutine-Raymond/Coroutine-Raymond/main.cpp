@@ -0,0 +1,265 @@
+#include "../../common/alloc_counter.h"
+#include "../../common/coro.h"
+#include "../../common/metrics.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+// Raymond's tree algorithm with every node as a coroutine, benchmarked against
+// the same protocol driven by a global message queue (as in RicartAgrawala/main.cpp)
+// Tree: parent of node i is (i - 1) / 2, node 0 starts with the token
+
+/* ----------------------  protocol definitions  ---------------------- */
+
+enum class MessageType
+{
+    Want,    // local CS request injected by the workload
+    Request, // REQUEST from a neighbour
+    Token
+};
+
+struct Message
+{
+    int from = 0; // sender ID
+    MessageType type = MessageType::Want;
+};
+
+// Requests waiting at one node: at most one per neighbour (parent, two children) and itself
+// Repeated local wants are only counted, self is re-queued after each CS entry
+struct RequestQueue
+{
+    std::array<int, 4> slots;
+    unsigned char head = 0;
+    unsigned char count = 0;
+    bool selfQueued = false;
+    int wants = 0; // local wants not queued yet
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+    void want(int self)
+    {
+        if (selfQueued)
+        {
+            wants++;
+            return;
+        }
+        selfQueued = true;
+        push(self);
+    }
+    // Called on CS entry
+    void served(int self)
+    {
+        selfQueued = false;
+        if (wants > 0)
+        {
+            wants--;
+            want(self);
+        }
+    }
+    void push(int id)
+    {
+        slots[(head + count++) & 3] = id;
+    }
+    int pop()
+    {
+        int id = slots[head];
+        head = (head + 1) & 3;
+        count--;
+        return id;
+    }
+};
+
+int initialHolder(int id)
+{
+    return id == 0 ? 0 : (id - 1) / 2;
+}
+
+// Run metrics, exported at the end of main
+std::uint64_t &coroMessages = metrics::counter("coro_messages_total");
+std::uint64_t &coroEntries = metrics::counter("coro_cs_entries_total");
+std::uint64_t &loopMessages = metrics::counter("loop_messages_total");
+std::uint64_t &loopEntries = metrics::counter("loop_cs_entries_total");
+
+/* -------------------------  coroutine nodes  ------------------------- */
+
+// The whole node protocol as one sequential routine, its state lives in the frame
+coro::Task raymondNode(coro::Network<Message> &net, int id)
+{
+    int holder = initialHolder(id); // neighbour towards the token, id itself when holding it
+    bool asked = false;             // REQUEST already sent to holder
+    RequestQueue q;
+
+    for (;;)
+    {
+        Message m = co_await net.receive(id);
+        if (m.type == MessageType::Token)
+            holder = id;
+        else if (m.type == MessageType::Want)
+            q.want(id);
+        else
+            q.push(m.from);
+
+        // Use the token or hand it to the oldest requester
+        while (holder == id && !q.empty())
+        {
+            int next = q.pop();
+            asked = false;
+            if (next == id)
+            {
+                coroEntries++; // CRITICAL SECTION
+                q.served(id);
+                continue;
+            }
+            holder = next;
+            coroMessages++;
+            co_await net.send(next, Message{id, MessageType::Token});
+        }
+        if (holder != id && !q.empty() && !asked)
+        {
+            asked = true;
+            coroMessages++;
+            co_await net.send(holder, Message{id, MessageType::Request});
+        }
+    }
+}
+
+/* ------------------------  queue-driven nodes  ------------------------ */
+
+struct LoopNode
+{
+    int holder;
+    bool asked = false;
+    RequestQueue q;
+};
+
+struct Delivery
+{
+    int to;
+    Message m;
+};
+
+// Same protocol as a callback over a global network queue
+void handle(std::vector<LoopNode> &nodes, std::queue<Delivery> &bus, int id, const Message &m)
+{
+    LoopNode &n = nodes[id];
+    if (m.type == MessageType::Token)
+        n.holder = id;
+    else if (m.type == MessageType::Want)
+        n.q.want(id);
+    else
+        n.q.push(m.from);
+
+    while (n.holder == id && !n.q.empty())
+    {
+        int next = n.q.pop();
+        n.asked = false;
+        if (next == id)
+        {
+            loopEntries++; // CRITICAL SECTION
+            n.q.served(id);
+            continue;
+        }
+        n.holder = next;
+        loopMessages++;
+        bus.push(Delivery{next, Message{id, MessageType::Token}});
+    }
+    if (n.holder != id && !n.q.empty() && !n.asked)
+    {
+        n.asked = true;
+        loopMessages++;
+        bus.push(Delivery{n.holder, Message{id, MessageType::Request}});
+    }
+}
+
+/* ---------------------------  benchmark  --------------------------- */
+
+double millisSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    int N, M;
+    std::cout << "Number of nodes (N): ";
+    std::cin >> N;
+    std::cout << "Number of CS requests (M): ";
+    std::cin >> M;
+    if (N <= 0 || M < 0)
+    {
+        std::cerr << "Invalid N or M.\n";
+        return 1;
+    }
+
+    // Same random requesters for both runs
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, N - 1);
+    std::vector<int> requesters(M);
+    for (int &r : requesters)
+        r = pick(rng);
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    /* --- coroutines --- */
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::size_t allocsBefore = alloc::count;
+        // In flight: every Want, one REQUEST per node and the token
+        coro::Network<Message> net(N, static_cast<std::size_t>(M) + N + 1);
+        std::vector<coro::Task> tasks;
+        tasks.reserve(N);
+        for (int i = 0; i < N; ++i)
+            tasks.push_back(raymondNode(net, i));
+        double setupMs = millisSince(start);
+
+        start = std::chrono::steady_clock::now();
+        std::size_t allocsRun = alloc::count;
+        for (int r : requesters)
+            net.post(r, Message{r, MessageType::Want});
+        net.run();
+        double runMs = millisSince(start);
+
+        std::cout << "Coroutines:  setup " << setupMs << " ms, run " << runMs << " ms, " << coroMessages
+                  << " messages, " << coroEntries << " CS entries\n";
+        std::cout << "             frame " << coro::FrameAllocator::instance().frameBytes << " bytes/node, "
+                  << allocsRun - allocsBefore << " setup operator new calls, " << alloc::count - allocsRun
+                  << " run operator new calls\n";
+    }
+
+    /* --- queue-driven loop --- */
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<LoopNode> nodes(N);
+        for (int i = 0; i < N; ++i)
+            nodes[i].holder = initialHolder(i);
+        std::queue<Delivery> bus;
+        double setupMs = millisSince(start);
+
+        start = std::chrono::steady_clock::now();
+        std::size_t allocsRun = alloc::count;
+        for (int r : requesters)
+            bus.push(Delivery{r, Message{r, MessageType::Want}});
+        while (!bus.empty())
+        {
+            Delivery d = bus.front();
+            bus.pop();
+            handle(nodes, bus, d.to, d.m);
+        }
+        double runMs = millisSince(start);
+
+        std::cout << "Queue loop:  setup " << setupMs << " ms, run " << runMs << " ms, " << loopMessages
+                  << " messages, " << loopEntries << " CS entries\n";
+        std::cout << "             state " << sizeof(LoopNode) << " bytes/node, " << alloc::count - allocsRun
+                  << " run operator new calls\n";
+    }
+
+    metrics::exportFromEnv();
+    return 0;
+}
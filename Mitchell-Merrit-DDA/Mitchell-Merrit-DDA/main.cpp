@@ -1,24 +1,101 @@
+#include "../../common/alloc_counter.h"
+#include "../../common/fixed.h"
+#include "../../common/metrics.h"
+#include "../../common/pool.h"
+#include "../../common/snapshot.h"
 #include <algorithm>
+#include <array>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
+// Run metrics, exported at the end of main
+std::uint64_t &blockOps = metrics::counter("mm_block_operations_total");
+std::uint64_t &transmitPasses = metrics::counter("mm_transmit_passes_total");
+std::uint64_t &labelUpdates = metrics::counter("mm_label_updates_total");
+std::uint64_t &dfsVisited = metrics::counter("mm_dfs_nodes_visited_total");
+metrics::Histogram &blockLatency = metrics::histogram("mm_block_transmit_ns");
+metrics::Histogram &saveLatency = metrics::histogram("mm_snapshot_save_ns");
+metrics::Histogram &restoreLatency = metrics::histogram("mm_snapshot_restore_ns");
+
+// Snapshot layout, shared by both detector types: labels plus the WFG as
+// per-process offsets into one array of edge targets
+constexpr std::uint32_t SnapshotKind = snapshot::code("MMDD");
+constexpr std::uint32_t ProcsTag = snapshot::code("nprc");
+constexpr std::uint32_t NextLabelTag = snapshot::code("lnxt");
+constexpr std::uint32_t PublicTag = snapshot::code("lpub");
+constexpr std::uint32_t PrivateTag = snapshot::code("lpri");
+constexpr std::uint32_t EdgeOffsetTag = snapshot::code("eoff");
+constexpr std::uint32_t EdgeTargetTag = snapshot::code("edst");
+
+// Restored labels and edge lists, checked against the detector size
+struct WfgImage
+{
+    snapshot::View<int> publicLabel, privateLabel, targets;
+    snapshot::View<std::uint32_t> offsets;
+    int nextLabel;
+
+    WfgImage(const snapshot::Mapping &m, int N)
+        : publicLabel(m.array<int>(PublicTag)), privateLabel(m.array<int>(PrivateTag)),
+          targets(m.array<int>(EdgeTargetTag)), offsets(m.array<std::uint32_t>(EdgeOffsetTag)),
+          nextLabel(m.scalar<int>(NextLabelTag))
+    {
+        if (publicLabel.size() != std::size_t(N) || privateLabel.size() != std::size_t(N) ||
+            offsets.size() != std::size_t(N) + 1 || offsets[0] != 0 || offsets[N] != targets.size())
+        {
+            throw std::runtime_error("Snapshot does not match the detector");
+        }
+        for (int x = 0; x < N; ++x)
+        {
+            if (offsets[x] > offsets[x + 1])
+                throw std::runtime_error("Snapshot edge offsets are not sorted");
+        }
+        for (int y : targets)
+        {
+            if (y < 0 || y >= N)
+                throw std::runtime_error("Snapshot edge target out of range");
+        }
+    }
+};
+
 class DeadlockDetector
 {
-    int N;                             // number of processes
-    std::vector<std::vector<int>> WFG; // Wait-For Graph: WFG[i] lists processes that i waits on
-    std::vector<int> publicLabel;      // u[i]
-    std::vector<int> privateLabel;     // v[i]
+    // Wait-for edge, kept in a per-process singly linked list
+    struct Edge
+    {
+        int to;
+        Edge *next;
+    };
+
+    int N;                         // number of processes
+    Arena edges;                   // storage for all WFG edges
+    std::vector<Edge *> WFG;       // Wait-For Graph: WFG[i] lists processes that i waits on
+    std::vector<Edge *> WFGTail;   // last edge of each list, keeps insertion order
+    std::vector<int> publicLabel;  // u[i]
+    std::vector<int> privateLabel; // v[i]
+    std::vector<bool> visited, inStack;
     int nextLabel = 1;
 
+    void addEdge(int i, int j)
+    {
+        Edge *e = edges.create<Edge>(Edge{j, nullptr});
+        (WFGTail[i] ? WFGTail[i]->next : WFG[i]) = e;
+        WFGTail[i] = e;
+    }
+
   public:
-    // Constructor: initialize N, WFG and labels to zero
-    DeadlockDetector(int n) : N(n), WFG(n), publicLabel(n, 0), privateLabel(n, 0) {};
+    // Constructor: initialize N, WFG and labels to zero, reserve room for maxEdges block operations
+    DeadlockDetector(int n, int maxEdges)
+        : N(n), edges(maxEdges * sizeof(Edge) + alignof(Edge)), WFG(n, nullptr), WFGTail(n, nullptr), publicLabel(n, 0),
+          privateLabel(n, 0), visited(n), inStack(n) {};
 
     // Block rule: process i blocks on process j
     void block(int i, int j)
     {
-        // add edge i->j
-        WFG[i].push_back(j);
+        addEdge(i, j); // add edge i->j
+        blockOps++;
         // update labels: new label = max(u[i], u[j]) + 1
         int k = std::max({publicLabel[i], publicLabel[j], nextLabel}) + 1;
         publicLabel[i] = privateLabel[i] = k;
@@ -33,29 +110,33 @@ class DeadlockDetector
         do
         {
             changed = false;
+            transmitPasses++;
             for (int x = 0; x < N; ++x)
             {
-                for (int y : WFG[x])
+                for (Edge *e = WFG[x]; e != nullptr; e = e->next)
                 {
+                    int y = e->to;
                     if (publicLabel[y] > publicLabel[x])
                     {
                         publicLabel[x] = publicLabel[y];
                         changed = true;
+                        labelUpdates++;
                     }
                 }
             }
         } while (changed);
     }
 
-    bool dfsCycle(int u, std::vector<std::vector<int>> &WFG, std::vector<bool> &visited, std::vector<bool> &inStack,
-                  int &foundAt)
+    bool dfsCycle(int u, int &foundAt)
     {
         visited[u] = inStack[u] = true;
-        for (int v : WFG[u])
+        dfsVisited++;
+        for (Edge *e = WFG[u]; e != nullptr; e = e->next)
         {
+            int v = e->to;
             if (!visited[v])
             {
-                if (dfsCycle(v, WFG, visited, inStack, foundAt))
+                if (dfsCycle(v, foundAt))
                     return true;
             }
             else if (inStack[v])
@@ -70,58 +151,310 @@ class DeadlockDetector
 
     bool detectCycle(int &cycleStart)
     {
-        std::vector<bool> visited(N, false), inStack(N, false);
+        std::fill(visited.begin(), visited.end(), false);
+        std::fill(inStack.begin(), inStack.end(), false);
         for (int i = 0; i < N; ++i)
         {
             if (!visited[i])
             {
-                if (dfsCycle(i, WFG, visited, inStack, cycleStart))
+                if (dfsCycle(i, cycleStart))
                     return true;
             }
         }
         return false;
     }
+
+    // Edge lists are written in insertion order
+    void save(snapshot::Writer &w) const
+    {
+        w.scalar(ProcsTag, N);
+        w.scalar(NextLabelTag, nextLabel);
+        w.array(PublicTag, publicLabel.data(), publicLabel.size());
+        w.array(PrivateTag, privateLabel.data(), privateLabel.size());
+        std::uint32_t total = 0;
+        w.begin<std::uint32_t>(EdgeOffsetTag);
+        w.value(total);
+        for (int x = 0; x < N; ++x)
+        {
+            for (Edge *e = WFG[x]; e != nullptr; e = e->next)
+                total++;
+            w.value(total);
+        }
+        w.end();
+        w.begin<int>(EdgeTargetTag);
+        for (int x = 0; x < N; ++x)
+        {
+            for (Edge *e = WFG[x]; e != nullptr; e = e->next)
+                w.value(e->to);
+        }
+        w.end();
+    }
+
+    // Replaces the state of a fresh detector, the arena must have room for the restored edges
+    void restore(const snapshot::Mapping &m)
+    {
+        WfgImage img(m, N);
+        std::copy(img.publicLabel.begin(), img.publicLabel.end(), publicLabel.begin());
+        std::copy(img.privateLabel.begin(), img.privateLabel.end(), privateLabel.begin());
+        nextLabel = img.nextLabel;
+        for (int x = 0; x < N; ++x)
+        {
+            for (std::uint32_t k = img.offsets[x]; k < img.offsets[x + 1]; ++k)
+                addEdge(x, img.targets[k]);
+        }
+    }
 };
 
+// Fixed-size variant for up to Cap processes: WFG rows are bit sets, labels a plain array
+// Repeated block(i, j) pairs collapse into one edge, which changes neither labels nor cycles
+template <int Cap> class FixedDeadlockDetector
+{
+    using Row = fixed::BitRow<Cap>;
+
+    int N;
+    std::array<Row, Cap> WFG{};
+    std::array<int, Cap> publicLabel{};
+    std::array<int, Cap> privateLabel{};
+    int nextLabel = 1;
+
+  public:
+    explicit FixedDeadlockDetector(int n) : N(n) {};
+
+    void block(int i, int j)
+    {
+        WFG[i].set(j);
+        blockOps++;
+        int k = std::max({publicLabel[i], publicLabel[j], nextLabel}) + 1;
+        publicLabel[i] = privateLabel[i] = k;
+        nextLabel = k;
+    }
+
+    void transmit()
+    {
+        bool changed;
+        do
+        {
+            changed = false;
+            transmitPasses++;
+            for (int x = 0; x < N; ++x)
+            {
+                int label = publicLabel[x];
+                for (int k = 0; k < Row::Words; ++k)
+                {
+                    for (std::uint64_t bits = WFG[x].w[k]; bits != 0; bits &= bits - 1)
+                    {
+                        int y = k * 64 + fixed::lowestBit(bits);
+                        if (publicLabel[y] > label)
+                        {
+                            label = publicLabel[y];
+                            labelUpdates++;
+                        }
+                    }
+                }
+                changed |= label != publicLabel[x];
+                publicLabel[x] = label;
+            }
+        } while (changed);
+    }
+
+    bool detectCycle(int &cycleStart)
+    {
+        cycleStart = fixed::findCycle<Cap>(WFG, N, dfsVisited);
+        return cycleStart >= 0;
+    }
+
+    // Same layout as DeadlockDetector, edge lists come out in ascending target order
+    void save(snapshot::Writer &w) const
+    {
+        w.scalar(ProcsTag, N);
+        w.scalar(NextLabelTag, nextLabel);
+        w.array(PublicTag, publicLabel.data(), N);
+        w.array(PrivateTag, privateLabel.data(), N);
+        std::uint32_t total = 0;
+        w.begin<std::uint32_t>(EdgeOffsetTag);
+        w.value(total);
+        for (int x = 0; x < N; ++x)
+        {
+            for (int k = 0; k < Row::Words; ++k)
+            {
+                for (std::uint64_t bits = WFG[x].w[k]; bits != 0; bits &= bits - 1)
+                    total++;
+            }
+            w.value(total);
+        }
+        w.end();
+        w.begin<int>(EdgeTargetTag);
+        for (int x = 0; x < N; ++x)
+        {
+            for (int k = 0; k < Row::Words; ++k)
+            {
+                for (std::uint64_t bits = WFG[x].w[k]; bits != 0; bits &= bits - 1)
+                    w.value(k * 64 + fixed::lowestBit(bits));
+            }
+        }
+        w.end();
+    }
+
+    void restore(const snapshot::Mapping &m)
+    {
+        WfgImage img(m, N);
+        std::copy(img.publicLabel.begin(), img.publicLabel.end(), publicLabel.begin());
+        std::copy(img.privateLabel.begin(), img.privateLabel.end(), privateLabel.begin());
+        nextLabel = img.nextLabel;
+        for (int x = 0; x < N; ++x)
+        {
+            for (std::uint32_t k = img.offsets[x]; k < img.offsets[x + 1]; ++k)
+                WFG[x].set(img.targets[k]);
+        }
+    }
+};
+
+template <class Detector> void saveSnapshot(const Detector &detector, const char *path)
+{
+    metrics::ScopedTimer timer(saveLatency);
+    snapshot::Writer w(path, SnapshotKind);
+    detector.save(w);
+    w.commit();
+}
+
+// Applies every block operation and reports the result, shared by both detector types
+// Starts from `restored` when given, checkpoints as configured by `cp` (none when null)
+template <class Detector>
+void runDetector(Detector &detector, const std::vector<std::pair<int, int>> &ops, const snapshot::Mapping *restored,
+                 const snapshot::Checkpoint *cp)
+{
+    if (restored != nullptr)
+    {
+        metrics::ScopedTimer timer(restoreLatency);
+        detector.restore(*restored);
+    }
+
+    std::size_t allocsBefore = alloc::count;
+    for (std::size_t t = 0; t < ops.size(); ++t)
+    {
+        {
+            metrics::ScopedTimer timer(blockLatency);
+            detector.block(ops[t].first, ops[t].second); // apply Block rule
+            detector.transmit();                         // propagate labels after each block
+        }
+        if (cp != nullptr && cp->due(t + 1))
+        {
+            saveSnapshot(detector, cp->savePath);
+        }
+    }
+
+    std::cout << "operator new calls during " << ops.size() << " block operations: " << alloc::count - allocsBefore
+              << "\n";
+
+    int cycleNode;
+    if (detector.detectCycle(cycleNode))
+    {
+        std::cout << "Deadlock detected involving process " << cycleNode << ".\n";
+    }
+    else
+    {
+        std::cout << "No deadlock detected.\n";
+    }
+
+    if (cp != nullptr && cp->savePath != nullptr)
+    {
+        saveSnapshot(detector, cp->savePath);
+    }
+}
+
+// Smallest fixed-size detector that fits N, the linked-list detector beyond that
+void runBest(int N, const std::vector<std::pair<int, int>> &ops, const snapshot::Mapping *restored,
+             const snapshot::Checkpoint *cp)
+{
+    auto run = [&](auto cap) {
+        constexpr int Cap = decltype(cap)::value;
+        FixedDeadlockDetector<Cap> detector(N);
+        runDetector(detector, ops, restored, cp);
+    };
+    if (!fixed::dispatch(N, run))
+    {
+        std::size_t restoredEdges = restored ? restored->array<int>(EdgeTargetTag).size() : 0;
+        DeadlockDetector detector(N, static_cast<int>(restoredEdges + ops.size()));
+        runDetector(detector, ops, restored, cp);
+    }
+}
+
 int main()
 {
+    snapshot::Checkpoint cp = snapshot::Checkpoint::fromEnv();
+    std::optional<snapshot::Mapping> restored;
+
     int N;
-    std::cout << "Enter number of processes: ";
-    std::cin >> N;
+    if (cp.restorePath != nullptr)
+    {
+        try
+        {
+            restored.emplace(cp.restorePath, SnapshotKind);
+            N = restored->scalar<int>(ProcsTag);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Restored " << N << " processes from " << cp.restorePath << "\n";
+    }
+    else
+    {
+        std::cout << "Enter number of processes: ";
+        std::cin >> N;
+    }
     if (N <= 0)
     {
         std::cerr << "Invalid number of processes.\n";
         return 1;
     }
 
-    DeadlockDetector detector(N);
     int M;
     std::cout << "Enter number of block operations: ";
     std::cin >> M;
+    if (M < 0)
+    {
+        std::cerr << "Invalid number of block operations.\n";
+        return 1;
+    }
 
     std::cout << "Enter " << M << " pairs 'i j' (process i blocks on process j):\n";
-    for (int t = 0; t < M; ++t)
+    std::vector<std::pair<int, int>> ops(M);
+    for (auto &[i, j] : ops)
     {
-        int i, j;
         std::cin >> i >> j;
         if (i < 0 || i >= N || j < 0 || j >= N)
         {
             std::cerr << "Invalid process ID: " << i << " or " << j << "\n";
             return 1;
         }
-        detector.block(i, j); // apply Block rule
-        detector.transmit();  // propagate labels after each block
     }
 
-    int cycleNode;
-    if (detector.detectCycle(cycleNode))
+    const snapshot::Mapping *from = restored ? &*restored : nullptr;
+    try
     {
-        std::cout << "Deadlock detected involving process " << cycleNode << ".\n";
+        runBest(N, ops, from, &cp);
     }
-    else
+    catch (const std::exception &e)
     {
-        std::cout << "No deadlock detected.\n";
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    // Repetitions below would inflate the counters, export what the real run recorded
+    metrics::Registry runMetrics = metrics::snapshot();
+    if (int reps = fixed::benchRepetitions())
+    {
+        std::size_t restoredEdges = from ? from->array<int>(EdgeTargetTag).size() : 0;
+        double genericUs = fixed::benchMicros(reps, [&] {
+            DeadlockDetector detector(N, static_cast<int>(restoredEdges + M));
+            runDetector(detector, ops, from, nullptr);
+        });
+        double fixedUs = fixed::benchMicros(reps, [&] { runBest(N, ops, from, nullptr); });
+        fixed::report("block + transmit", N, reps, genericUs, fixedUs);
     }
 
+    metrics::exportFromEnv(runMetrics);
     return 0;
 }
@@ -0,0 +1,911 @@
+#include "../../common/metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Explicit-state model checker for the mutual-exclusion protocols
+// Explores every message delivery order for small N with a parallel level-synchronous BFS,
+// states are deduplicated in a lock-free hash set and reduced with ample sets
+// Checks safety (at most one Held) and liveness (no reachable terminal state with a Wanted node)
+
+static constexpr int MaxN = 4;
+
+enum Phase : std::uint8_t
+{
+    Released,
+    Wanted,
+    Held
+};
+
+enum class Kind : std::uint8_t
+{
+    Want,    // node asks for the CS
+    Enter,   // token holder enters the CS
+    Exit,    // node leaves the CS
+    Deliver, // message delivered to node
+    Pass     // token handed to the ring successor
+};
+
+// Transition label, kept with every state for counterexample traces
+struct Label
+{
+    Kind kind = Kind::Want;
+    std::uint8_t node = 0;
+    std::uint8_t from = 0;
+    std::uint8_t msgType = 0;
+    std::uint16_t ts = 0;
+};
+
+struct Config
+{
+    int N = 3;
+    int requests = 1; // CS requests per node
+    bool buggy = false;
+};
+
+/* ----------------------  message multiset  ---------------------- */
+
+// Unordered network: sorted codes, 0 = free slot, so equal networks encode equally
+template <class Code, int Cap> struct Network
+{
+    Code msgs[Cap];
+
+    int size() const
+    {
+        int n = 0;
+        while (n < Cap && msgs[n] != 0)
+            n++;
+        return n;
+    }
+    bool add(Code c)
+    {
+        int n = size();
+        if (n == Cap)
+            return false;
+        msgs[n] = c;
+        std::sort(msgs, msgs + n + 1);
+        return true;
+    }
+    void removeAt(int i)
+    {
+        int n = size();
+        for (int k = i; k + 1 < n; ++k)
+            msgs[k] = msgs[k + 1];
+        msgs[n - 1] = 0;
+    }
+};
+
+/* ----------------------  Ricart-Agrawala  ---------------------- */
+
+// Same rules as RicartAgrawala/main.cpp, with the CS held until a separate Exit step
+struct RicartAgrawalaModel
+{
+    static constexpr int MaxMsgs = 2 * MaxN * (MaxN - 1);
+    enum MsgType
+    {
+        Request,
+        Reply
+    };
+
+    struct State
+    {
+        std::uint8_t clock[MaxN];
+        std::uint8_t phase[MaxN];
+        std::uint8_t requestTs[MaxN];
+        std::uint8_t replies[MaxN];  // bitmap of REPLYs collected
+        std::uint8_t deferred[MaxN]; // bitmap of deferred requesters
+        std::uint8_t remaining[MaxN];
+        Network<std::uint16_t, MaxMsgs> net; // 1 + (from | to << 2 | type << 4 | ts << 5)
+    };
+
+    Config cfg;
+    std::atomic<bool> overflow{false}; // written by worker threads
+
+    static std::uint16_t encode(int from, int to, int type, int ts)
+    {
+        return static_cast<std::uint16_t>(1 + (from | to << 2 | type << 4 | ts << 5));
+    }
+
+    State initial() const
+    {
+        State s{};
+        for (int i = 0; i < cfg.N; ++i)
+            s.remaining[i] = static_cast<std::uint8_t>(cfg.requests);
+        return s;
+    }
+
+    void tick(State &s, int i)
+    {
+        if (++s.clock[i] == 255)
+            overflow = true; // timestamps must fit the message code
+    }
+
+    void send(State &s, int from, int to, int type, int ts)
+    {
+        if (!s.net.add(encode(from, to, type, ts)))
+            overflow = true;
+    }
+
+    bool allReplies(const State &s, int i) const
+    {
+        return s.replies[i] == (1 << cfg.N) - 1;
+    }
+
+    template <class Emit> void expand(const State &s, Emit &&emit)
+    {
+        int N = cfg.N;
+        for (int i = 0; i < N; ++i)
+        {
+            if (s.phase[i] == Released && s.remaining[i] > 0)
+            {
+                State t = s;
+                t.remaining[i]--;
+                t.phase[i] = Wanted;
+                tick(t, i);
+                t.requestTs[i] = t.clock[i];
+                t.replies[i] = static_cast<std::uint8_t>(1 << i);
+                for (int j = 0; j < N; ++j)
+                {
+                    if (j != i)
+                    {
+                        tick(t, i);
+                        send(t, i, j, Request, t.requestTs[i]);
+                    }
+                }
+                bool enter = allReplies(t, i);
+                if (enter)
+                    t.phase[i] = Held;
+                emit(t, Label{Kind::Want, std::uint8_t(i)}, i, enter);
+            }
+            if (s.phase[i] == Held)
+            {
+                State t = s;
+                t.phase[i] = Released;
+                for (int j = 0; j < N; ++j)
+                {
+                    if (t.deferred[i] & (1 << j))
+                    {
+                        tick(t, i);
+                        send(t, i, j, Reply, t.clock[i]);
+                    }
+                }
+                t.deferred[i] = 0;
+                emit(t, Label{Kind::Exit, std::uint8_t(i)}, i, true);
+            }
+        }
+
+        for (int k = 0; k < MaxMsgs && s.net.msgs[k] != 0; ++k)
+        {
+            if (k > 0 && s.net.msgs[k] == s.net.msgs[k - 1])
+                continue; // identical copies give identical successors
+            int code = s.net.msgs[k] - 1;
+            int from = code & 3, to = (code >> 2) & 3, type = (code >> 4) & 1, ts = code >> 5;
+
+            State t = s;
+            t.net.removeAt(k);
+            t.clock[to] = static_cast<std::uint8_t>(std::max<int>(t.clock[to], ts));
+            tick(t, to);
+            bool visible = false;
+            if (type == Reply)
+            {
+                t.replies[to] |= static_cast<std::uint8_t>(1 << from);
+                if (t.phase[to] == Wanted && allReplies(t, to))
+                {
+                    t.phase[to] = Held;
+                    visible = true;
+                }
+            }
+            else
+            {
+                bool later = std::make_pair(ts, from) > std::make_pair(int(t.requestTs[to]), to);
+                bool deferIt = (t.phase[to] == Wanted && later) || (!cfg.buggy && t.phase[to] == Held);
+                if (deferIt)
+                {
+                    t.deferred[to] |= static_cast<std::uint8_t>(1 << from);
+                }
+                else
+                {
+                    tick(t, to);
+                    send(t, to, from, Reply, t.clock[to]);
+                }
+            }
+            emit(t,
+                 Label{Kind::Deliver, std::uint8_t(to), std::uint8_t(from), std::uint8_t(type), std::uint16_t(ts)},
+                 to, visible);
+        }
+    }
+
+    // No other node can send to a before a moves: nobody will broadcast again,
+    // nobody defers a, and every REPLY a still waits for is already in flight
+    bool quiescent(const State &s, int a) const
+    {
+        for (int b = 0; b < cfg.N; ++b)
+        {
+            if (b == a)
+                continue;
+            if (s.remaining[b] > 0 || (s.deferred[b] & (1 << a)))
+                return false;
+            if (s.phase[a] == Wanted && !(s.replies[a] & (1 << b)))
+            {
+                bool inFlight = false;
+                for (int k = 0; k < MaxMsgs && s.net.msgs[k] != 0; ++k)
+                {
+                    int code = s.net.msgs[k] - 1;
+                    if ((code & 3) == b && ((code >> 2) & 3) == a && ((code >> 4) & 1) == Reply)
+                        inFlight = true;
+                }
+                if (!inFlight)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    int held(const State &s) const
+    {
+        return static_cast<int>(std::count(s.phase, s.phase + cfg.N, Held));
+    }
+
+    bool starving(const State &s) const
+    {
+        return std::count(s.phase, s.phase + cfg.N, Wanted) > 0;
+    }
+
+    std::string describe(const Label &l) const
+    {
+        switch (l.kind)
+        {
+        case Kind::Want:
+            return "Node " + std::to_string(l.node) + " requests CS";
+        case Kind::Exit:
+            return "Node " + std::to_string(l.node) + " leaves CS";
+        default:
+            return "Node " + std::to_string(l.node) + " gets " + (l.msgType == Request ? "REQ" : "REP") + " from " +
+                   std::to_string(l.from) + " @ts=" + std::to_string(l.ts);
+        }
+    }
+
+    std::string show(const State &s) const
+    {
+        static const char *names[] = {"Released", "Wanted", "Held"};
+        std::string out;
+        for (int i = 0; i < cfg.N; ++i)
+            out += " P" + std::to_string(i) + "=" + names[s.phase[i]] + "@" + std::to_string(s.clock[i]);
+        return out + " | in flight: " + std::to_string(s.net.size());
+    }
+};
+
+/* ----------------------  Raymond  ---------------------- */
+
+// Message-passing Raymond on the tree parent(i) = (i - 1) / 2, node 0 starts with the token
+struct RaymondModel
+{
+    static constexpr int MaxMsgs = 2 * MaxN;
+    enum MsgType
+    {
+        Request,
+        Token
+    };
+
+    struct State
+    {
+        std::uint8_t holder[MaxN];
+        std::uint8_t asked[MaxN];
+        std::uint8_t phase[MaxN];
+        std::uint8_t remaining[MaxN];
+        std::uint8_t qlen[MaxN];
+        std::uint8_t q[MaxN][MaxN]; // FIFO of requesters, q[i][0] is the oldest
+        Network<std::uint8_t, MaxMsgs> net; // 1 + (from | to << 2 | type << 4)
+    };
+
+    Config cfg;
+    std::atomic<bool> overflow{false}; // written by worker threads
+
+    bool neighbours(int a, int b) const
+    {
+        return a != b && (a == (b - 1) / 2 || b == (a - 1) / 2) && a < cfg.N && b < cfg.N;
+    }
+
+    State initial() const
+    {
+        State s{};
+        for (int i = 0; i < cfg.N; ++i)
+        {
+            s.holder[i] = static_cast<std::uint8_t>(i == 0 ? 0 : (i - 1) / 2);
+            s.remaining[i] = static_cast<std::uint8_t>(cfg.requests);
+        }
+        return s;
+    }
+
+    void send(State &s, int from, int to, int type)
+    {
+        if (!s.net.add(static_cast<std::uint8_t>(1 + (from | to << 2 | type << 4))))
+            overflow = true;
+    }
+
+    void push(State &s, int i, int who)
+    {
+        if (s.qlen[i] == MaxN)
+        {
+            overflow = true;
+            return;
+        }
+        s.q[i][s.qlen[i]++] = static_cast<std::uint8_t>(who);
+    }
+
+    // ASSIGN_PRIVILEGE followed by MAKE_REQUEST
+    void react(State &s, int i)
+    {
+        if (s.holder[i] == i && s.phase[i] != Held && s.qlen[i] > 0)
+        {
+            int next = s.q[i][0];
+            std::memmove(s.q[i], s.q[i] + 1, MaxN - 1);
+            s.q[i][--s.qlen[i]] = 0;
+            s.asked[i] = 0;
+            if (next == i)
+            {
+                s.phase[i] = Held;
+            }
+            else
+            {
+                s.holder[i] = static_cast<std::uint8_t>(next);
+                send(s, i, next, Token);
+            }
+        }
+        if (s.holder[i] != i && s.qlen[i] > 0 && !s.asked[i])
+        {
+            send(s, i, s.holder[i], Request);
+            s.asked[i] = 1;
+        }
+    }
+
+    template <class Emit> void expand(const State &s, Emit &&emit)
+    {
+        for (int i = 0; i < cfg.N; ++i)
+        {
+            if (s.phase[i] == Released && s.remaining[i] > 0)
+            {
+                State t = s;
+                t.remaining[i]--;
+                t.phase[i] = Wanted;
+                push(t, i, i);
+                react(t, i);
+                emit(t, Label{Kind::Want, std::uint8_t(i)}, i, t.phase[i] == Held);
+            }
+            if (s.phase[i] == Held)
+            {
+                State t = s;
+                t.phase[i] = Released;
+                react(t, i);
+                emit(t, Label{Kind::Exit, std::uint8_t(i)}, i, true);
+            }
+        }
+
+        for (int k = 0; k < MaxMsgs && s.net.msgs[k] != 0; ++k)
+        {
+            if (k > 0 && s.net.msgs[k] == s.net.msgs[k - 1])
+                continue;
+            int code = s.net.msgs[k] - 1;
+            int from = code & 3, to = (code >> 2) & 3, type = (code >> 4) & 1;
+
+            State t = s;
+            t.net.removeAt(k);
+            if (type == Token)
+                t.holder[to] = static_cast<std::uint8_t>(to);
+            else
+                push(t, to, from);
+            bool wasHeld = t.phase[to] == Held;
+            react(t, to);
+            emit(t, Label{Kind::Deliver, std::uint8_t(to), std::uint8_t(from), std::uint8_t(type)}, to,
+                 wasHeld != (t.phase[to] == Held));
+        }
+    }
+
+    bool inFlight(const State &s, int to, int type) const
+    {
+        for (int k = 0; k < MaxMsgs && s.net.msgs[k] != 0; ++k)
+        {
+            int code = s.net.msgs[k] - 1;
+            if (((code >> 2) & 3) == to && ((code >> 4) & 1) == type)
+                return true;
+        }
+        return false;
+    }
+
+    // Only neighbours talk to a: no TOKEN can reach a while a owns it, and a neighbour
+    // pointing at a sends a REQUEST only if it has not asked yet and new demand can still appear
+    bool quiescent(const State &s, int a) const
+    {
+        if (s.holder[a] != a && !inFlight(s, a, Token))
+            return false;
+
+        bool demand = false;
+        for (int x = 0; x < cfg.N; ++x)
+        {
+            if (x != a && (s.remaining[x] > 0 || inFlight(s, x, Request)))
+                demand = true;
+        }
+        for (int b = 0; b < cfg.N; ++b)
+        {
+            if (neighbours(a, b) && s.holder[b] == a && !s.asked[b] && demand)
+                return false;
+        }
+        return true;
+    }
+
+    int held(const State &s) const
+    {
+        return static_cast<int>(std::count(s.phase, s.phase + cfg.N, Held));
+    }
+
+    bool starving(const State &s) const
+    {
+        return std::count(s.phase, s.phase + cfg.N, Wanted) > 0;
+    }
+
+    std::string describe(const Label &l) const
+    {
+        switch (l.kind)
+        {
+        case Kind::Want:
+            return "Node " + std::to_string(l.node) + " requests CS";
+        case Kind::Exit:
+            return "Node " + std::to_string(l.node) + " leaves CS";
+        default:
+            return "Node " + std::to_string(l.node) + " gets " + (l.msgType == Request ? "REQUEST" : "TOKEN") +
+                   " from " + std::to_string(l.from);
+        }
+    }
+
+    std::string show(const State &s) const
+    {
+        static const char *names[] = {"Released", "Wanted", "Held"};
+        std::string out;
+        for (int i = 0; i < cfg.N; ++i)
+            out += " P" + std::to_string(i) + "=" + names[s.phase[i]] + ">" + std::to_string(s.holder[i]);
+        return out + " | in flight: " + std::to_string(s.net.size());
+    }
+};
+
+/* ----------------------  token ring  ---------------------- */
+
+// Token moves one hop at a time, and only while some other node wants the CS
+struct TokenRingModel
+{
+    struct State
+    {
+        std::uint8_t phase[MaxN];
+        std::uint8_t remaining[MaxN];
+        std::uint8_t tokenAt;   // holder, or destination while in transit
+        std::uint8_t inTransit; // TOKEN message on the wire
+    };
+
+    Config cfg;
+    std::atomic<bool> overflow{false}; // written by worker threads
+
+    State initial() const
+    {
+        State s{};
+        for (int i = 0; i < cfg.N; ++i)
+            s.remaining[i] = static_cast<std::uint8_t>(cfg.requests);
+        return s;
+    }
+
+    bool othersWant(const State &s, int i) const
+    {
+        for (int j = 0; j < cfg.N; ++j)
+            if (j != i && s.phase[j] == Wanted)
+                return true;
+        return false;
+    }
+
+    template <class Emit> void expand(const State &s, Emit &&emit)
+    {
+        for (int i = 0; i < cfg.N; ++i)
+        {
+            if (s.phase[i] == Released && s.remaining[i] > 0)
+            {
+                State t = s;
+                t.remaining[i]--;
+                t.phase[i] = Wanted;
+                emit(t, Label{Kind::Want, std::uint8_t(i)}, i, false);
+            }
+            if (s.tokenAt != i)
+                continue;
+            if (s.inTransit)
+            {
+                State t = s;
+                t.inTransit = 0;
+                emit(t, Label{Kind::Deliver, std::uint8_t(i), std::uint8_t((i + cfg.N - 1) % cfg.N)}, i, false);
+            }
+            else if (s.phase[i] == Wanted)
+            {
+                State t = s;
+                t.phase[i] = Held;
+                emit(t, Label{Kind::Enter, std::uint8_t(i)}, i, true);
+            }
+            else if (s.phase[i] == Held)
+            {
+                State t = s;
+                t.phase[i] = Released;
+                emit(t, Label{Kind::Exit, std::uint8_t(i)}, i, true);
+            }
+            else if (othersWant(s, i))
+            {
+                State t = s;
+                t.tokenAt = static_cast<std::uint8_t>((i + 1) % cfg.N);
+                t.inTransit = 1;
+                emit(t, Label{Kind::Pass, std::uint8_t(i)}, i, false);
+            }
+        }
+    }
+
+    // Only the token reaches a node, and a's Pass step reads the other phases:
+    // a is independent of the rest only while it owns the token and no new demand can appear
+    bool quiescent(const State &s, int a) const
+    {
+        if (s.tokenAt != a)
+            return false;
+        for (int b = 0; b < cfg.N; ++b)
+            if (b != a && s.remaining[b] > 0 && s.phase[b] != Wanted)
+                return false;
+        return true;
+    }
+
+    int held(const State &s) const
+    {
+        return static_cast<int>(std::count(s.phase, s.phase + cfg.N, Held));
+    }
+
+    bool starving(const State &s) const
+    {
+        return std::count(s.phase, s.phase + cfg.N, Wanted) > 0;
+    }
+
+    std::string describe(const Label &l) const
+    {
+        switch (l.kind)
+        {
+        case Kind::Want:
+            return "Node " + std::to_string(l.node) + " requests CS";
+        case Kind::Exit:
+            return "Node " + std::to_string(l.node) + " leaves CS";
+        case Kind::Enter:
+            return "Node " + std::to_string(l.node) + " enters CS";
+        case Kind::Pass:
+            return "Node " + std::to_string(l.node) + " passes TOKEN";
+        default:
+            return "Node " + std::to_string(l.node) + " gets TOKEN from " + std::to_string(l.from);
+        }
+    }
+
+    std::string show(const State &s) const
+    {
+        static const char *names[] = {"Released", "Wanted", "Held"};
+        std::string out;
+        for (int i = 0; i < cfg.N; ++i)
+            out += " P" + std::to_string(i) + "=" + names[s.phase[i]];
+        return out + " | token " + (s.inTransit ? "-> " : "at ") + std::to_string(s.tokenAt);
+    }
+};
+
+/* ----------------------  checker  ---------------------- */
+
+template <class Model> class Checker
+{
+    using State = typename Model::State;
+    static constexpr std::uint32_t None = UINT32_MAX;
+
+    struct Record
+    {
+        State s;
+        std::uint32_t parent;
+        Label label;
+    };
+
+    struct Successor
+    {
+        State s;
+        Label label;
+        int actor;
+        bool visible;
+    };
+
+    Model model;
+    std::vector<Record> records; // preallocated, slots point into it
+    std::atomic<std::uint32_t> nextRecord{0};
+    std::atomic<std::uint32_t> stored{0}; // published records, races can leave reserved ones unused
+    std::vector<std::atomic<std::uint64_t>> slots; // (tag << 32) | (record + 1), 0 = empty
+    std::uint64_t mask;
+    bool por;
+
+    std::atomic<bool> full{false};
+    std::atomic<std::uint32_t> safetyBad{None};
+    std::atomic<std::uint32_t> livenessBad{None};
+    std::atomic<std::uint64_t> transitions{0};
+
+    static std::size_t tableSize(std::size_t maxStates)
+    {
+        std::size_t cap = 1;
+        while (cap < 2 * maxStates)
+            cap <<= 1;
+        return cap;
+    }
+
+    static std::uint64_t hashOf(const State &s)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(&s);
+        std::uint64_t h = 1469598103934665603ull;
+        for (std::size_t i = 0; i < sizeof(State); ++i)
+            h = (h ^ p[i]) * 1099511628211ull;
+        return h ^ (h >> 29);
+    }
+
+    std::uint32_t lookup(const State &s) const
+    {
+        std::uint64_t h = hashOf(s);
+        std::uint32_t tag = static_cast<std::uint32_t>(h >> 32);
+        for (std::uint64_t i = h & mask;; i = (i + 1) & mask)
+        {
+            std::uint64_t e = slots[i].load(std::memory_order_acquire);
+            if (e == 0)
+                return None;
+            std::uint32_t idx = static_cast<std::uint32_t>(e) - 1;
+            if (static_cast<std::uint32_t>(e >> 32) == tag && std::memcmp(&records[idx].s, &s, sizeof(State)) == 0)
+                return idx;
+        }
+    }
+
+    // Returns the record of s and whether this call added it
+    std::pair<std::uint32_t, bool> insert(const State &s, std::uint32_t parent, const Label &label)
+    {
+        std::uint64_t h = hashOf(s);
+        std::uint32_t tag = static_cast<std::uint32_t>(h >> 32);
+        std::uint32_t mine = None;
+        for (std::uint64_t i = h & mask;; i = (i + 1) & mask)
+        {
+            std::uint64_t e = slots[i].load(std::memory_order_acquire);
+            if (e == 0)
+            {
+                if (mine == None)
+                {
+                    mine = nextRecord.fetch_add(1, std::memory_order_relaxed);
+                    if (mine >= records.size())
+                    {
+                        full = true;
+                        return {None, false};
+                    }
+                    records[mine] = Record{s, parent, label};
+                }
+                std::uint64_t entry = (std::uint64_t(tag) << 32) | (mine + 1);
+                if (slots[i].compare_exchange_strong(e, entry, std::memory_order_acq_rel))
+                {
+                    stored.fetch_add(1, std::memory_order_relaxed);
+                    return {mine, true};
+                }
+                // Lost the race, e now holds the winner: fall through and compare
+            }
+            std::uint32_t idx = static_cast<std::uint32_t>(e) - 1;
+            if (static_cast<std::uint32_t>(e >> 32) == tag && std::memcmp(&records[idx].s, &s, sizeof(State)) == 0)
+                return {idx, false}; // a reserved but unpublished record is simply left unused
+        }
+    }
+
+    void expand(std::uint32_t idx, std::vector<Successor> &succ, std::vector<std::uint32_t> &next,
+                std::uint64_t &reduced)
+    {
+        const State &s = records[idx].s;
+        succ.clear();
+        model.expand(s, [&](const State &t, const Label &l, int actor, bool visible) {
+            succ.push_back(Successor{t, l, actor, visible});
+        });
+
+        if (succ.empty())
+        {
+            std::uint32_t none = None;
+            if (model.starving(s))
+                livenessBad.compare_exchange_strong(none, idx);
+            return;
+        }
+
+        // Ample set: all moves of one quiescent node, none of them visible and none
+        // closing onto a known state (cycle proviso), otherwise expand everything
+        int chosen = -1;
+        if (por)
+        {
+            for (int a = 0; a < model.cfg.N && chosen < 0; ++a)
+            {
+                bool any = false, ok = model.quiescent(s, a);
+                for (const Successor &x : succ)
+                {
+                    if (x.actor != a)
+                        continue;
+                    any = true;
+                    if (x.visible || lookup(x.s) != None)
+                        ok = false;
+                }
+                if (any && ok)
+                    chosen = a;
+            }
+        }
+        auto pruned = [&](const Successor &x) { return x.actor != chosen; };
+        if (chosen >= 0 && std::any_of(succ.begin(), succ.end(), pruned))
+            reduced++;
+
+        for (const Successor &x : succ)
+        {
+            if (chosen >= 0 && x.actor != chosen)
+                continue;
+            transitions.fetch_add(1, std::memory_order_relaxed);
+            auto [rec, added] = insert(x.s, idx, x.label);
+            if (!added)
+                continue;
+            next.push_back(rec);
+            if (model.held(x.s) > 1)
+            {
+                std::uint32_t none = None;
+                safetyBad.compare_exchange_strong(none, rec);
+            }
+        }
+    }
+
+    void printTrace(std::uint32_t idx) const
+    {
+        std::vector<std::uint32_t> path;
+        for (std::uint32_t i = idx; i != None; i = records[i].parent)
+            path.push_back(i);
+        std::reverse(path.begin(), path.end());
+
+        std::cout << "  init:" << model.show(records[path[0]].s) << "\n";
+        for (std::size_t k = 1; k < path.size(); ++k)
+        {
+            const Record &r = records[path[k]];
+            std::cout << "  " << k << ". " << model.describe(r.label) << "\n     " << model.show(r.s) << "\n";
+        }
+    }
+
+  public:
+    Checker(const Config &cfg, std::size_t maxStates, bool usePor)
+        : records(maxStates), slots(tableSize(maxStates)), mask(slots.size() - 1), por(usePor)
+    {
+        model.cfg = cfg;
+    };
+
+    // Returns false when a property is violated
+    bool run(int threads)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::uint32_t> frontier{insert(model.initial(), None, Label{}).first};
+        int depth = 0;
+
+        while (!frontier.empty() && !full && safetyBad == None && livenessBad == None)
+        {
+            std::atomic<std::size_t> cursor{0};
+            std::vector<std::vector<std::uint32_t>> nextParts(threads);
+            auto worker = [&](int w) {
+                // Per-thread metrics, merged at export
+                std::uint64_t &expanded = metrics::counter("mc_states_expanded_total");
+                std::uint64_t &reduced = metrics::counter("mc_ample_reductions_total");
+                std::vector<Successor> succ;
+                constexpr std::size_t Chunk = 64;
+                for (std::size_t k; (k = cursor.fetch_add(Chunk)) < frontier.size();)
+                {
+                    for (std::size_t i = k; i < std::min(k + Chunk, frontier.size()); ++i)
+                    {
+                        expand(frontier[i], succ, nextParts[w], reduced);
+                        expanded++;
+                    }
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for (int w = 1; w < threads; ++w)
+                pool.emplace_back(worker, w);
+            worker(0);
+            for (std::thread &t : pool)
+                t.join();
+
+            frontier.clear();
+            for (auto &part : nextParts)
+                frontier.insert(frontier.end(), part.begin(), part.end());
+            depth++;
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "States: " << stored << ", transitions: " << transitions << ", depth: " << depth
+                  << ", time: " << ms << " ms\n";
+
+        if (full)
+            std::cout << "State limit reached, search incomplete.\n";
+        if (model.overflow)
+            std::cout << "Model bounds exceeded (clock or buffers), search unsound.\n";
+
+        bool ok = true;
+        if (safetyBad != None)
+        {
+            ok = false;
+            std::cout << "Safety VIOLATED: two nodes Held. Counterexample:\n";
+            printTrace(safetyBad);
+        }
+        else if (!full)
+        {
+            std::cout << "Safety OK: at most one node Held in every reachable state.\n";
+        }
+        if (livenessBad != None)
+        {
+            ok = false;
+            std::cout << "Liveness VIOLATED: execution ends with a node still Wanted. Counterexample:\n";
+            printTrace(livenessBad);
+        }
+        else if (!full && safetyBad == None)
+        {
+            std::cout << "Liveness OK: every maximal execution serves all requests.\n";
+        }
+        return ok;
+    }
+};
+
+template <class Model> bool check(const Config &cfg, std::size_t maxStates, int threads, bool por)
+{
+    Checker<Model> checker(cfg, maxStates, por);
+    return checker.run(threads);
+}
+
+int main()
+{
+    std::string protocol;
+    Config cfg;
+    std::size_t maxStates;
+    int threads, por;
+
+    std::cout << "Protocol (ra / ra-bug / raymond / ring): ";
+    std::cin >> protocol;
+    std::cout << "Number of nodes N (1-" << MaxN << "): ";
+    std::cin >> cfg.N;
+    std::cout << "CS requests per node: ";
+    std::cin >> cfg.requests;
+    std::cout << "State limit: ";
+    std::cin >> maxStates;
+    std::cout << "Threads (0 = all cores): ";
+    std::cin >> threads;
+    std::cout << "Partial-order reduction (0/1): ";
+    std::cin >> por;
+
+    if (!std::cin || cfg.N < 1 || cfg.N > MaxN || cfg.requests < 0 || cfg.requests > 15 || maxStates == 0 ||
+        maxStates >= UINT32_MAX)
+    {
+        std::cerr << "Invalid parameters.\n";
+        return 1;
+    }
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    bool ok;
+    if (protocol == "ra" || protocol == "ra-bug")
+    {
+        cfg.buggy = protocol == "ra-bug"; // answers requests while Held
+        ok = check<RicartAgrawalaModel>(cfg, maxStates, threads, por == 1);
+    }
+    else if (protocol == "raymond")
+    {
+        ok = check<RaymondModel>(cfg, maxStates, threads, por == 1);
+    }
+    else if (protocol == "ring")
+    {
+        ok = check<TokenRingModel>(cfg, maxStates, threads, por == 1);
+    }
+    else
+    {
+        std::cerr << "Unknown protocol: " << protocol << "\n";
+        return 1;
+    }
+
+    metrics::exportFromEnv();
+    return ok ? 0 : 2;
+}
@@ -1,21 +1,145 @@
-﻿#include <iostream>
+﻿#include "../../common/alloc_counter.h"
+#include "../../common/metrics.h"
+#include "../../common/pool.h"
+#include "../../common/snapshot.h"
+#include <algorithm>
+#include <iostream>
 #include <map>
-#include <queue>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 struct Node
 {
-    int id;            // node ID
-    int parent;        // parent ID (0 = none)
-    bool hasToken;     // whether it currently holds the token
-    std::queue<int> q; // IDs of requesting nodes
+    int id;                // node ID
+    int parent;            // parent ID (0 = none)
+    bool hasToken;         // whether it currently holds the token
+    RingQueue<int> q;      // IDs of requesting nodes
+    std::vector<bool> inQ; // inQ[r - 1]: r is already in q, so every queue stays within N entries
 
     Node(int ID = 0) : id(ID), parent(0), hasToken(false) {};
+
+    void reserve(int N)
+    {
+        q.reserve(N);
+        inQ.assign(N, false);
+    }
+
+    // Requests from a node that is already queued here are served by its existing entry
+    void enqueue(int requester)
+    {
+        if (!inQ[requester - 1])
+        {
+            inQ[requester - 1] = true;
+            q.push(requester);
+        }
+    }
+
+    int dequeue()
+    {
+        int requester = q.front();
+        q.pop();
+        inQ[requester - 1] = false;
+        return requester;
+    }
+
+    void clearQueue()
+    {
+        for (std::size_t i = 0; i < q.size(); ++i)
+        {
+            inQ[q[i] - 1] = false;
+        }
+        q.clear();
+    }
 };
 
 std::vector<Node> nodes; // global list
 
+// Run metrics, exported at the end of main
+std::uint64_t &csRequests = metrics::counter("raymond_cs_requests_total");
+std::uint64_t &requestMessages = metrics::counter("raymond_request_messages_total");
+std::uint64_t &tokenMessages = metrics::counter("raymond_token_messages_total");
+std::uint64_t &edgeReversals = metrics::counter("raymond_edge_reversals_total");
+metrics::Histogram &requestLatency = metrics::histogram("raymond_request_cs_ns");
+metrics::Histogram &saveLatency = metrics::histogram("raymond_snapshot_save_ns");
+metrics::Histogram &restoreLatency = metrics::histogram("raymond_snapshot_restore_ns");
+
+// Snapshot layout: per-node parent and token flag, request queues as
+// per-node offsets into one array of requester IDs (front first)
+constexpr std::uint32_t SnapshotKind = snapshot::code("RAYM");
+constexpr std::uint32_t NodesTag = snapshot::code("nnod");
+constexpr std::uint32_t ParentTag = snapshot::code("prnt");
+constexpr std::uint32_t TokenTag = snapshot::code("tokn");
+constexpr std::uint32_t QueueOffsetTag = snapshot::code("qoff");
+constexpr std::uint32_t QueueIdsTag = snapshot::code("qids");
+
+void saveSnapshot(const char *path)
+{
+    metrics::ScopedTimer timer(saveLatency);
+    snapshot::Writer w(path, SnapshotKind);
+    w.scalar(NodesTag, static_cast<int>(nodes.size()));
+    w.begin<int>(ParentTag);
+    for (const Node &n : nodes)
+        w.value(n.parent);
+    w.end();
+    w.begin<std::uint8_t>(TokenTag);
+    for (const Node &n : nodes)
+        w.value<std::uint8_t>(n.hasToken);
+    w.end();
+    std::uint32_t total = 0;
+    w.begin<std::uint32_t>(QueueOffsetTag);
+    w.value(total);
+    for (const Node &n : nodes)
+    {
+        total += static_cast<std::uint32_t>(n.q.size());
+        w.value(total);
+    }
+    w.end();
+    w.begin<int>(QueueIdsTag);
+    for (const Node &n : nodes)
+    {
+        for (std::size_t i = 0; i < n.q.size(); ++i)
+            w.value(n.q[i]);
+    }
+    w.end();
+    w.commit();
+}
+
+// Rebuilds `nodes` from a mapped snapshot, throws if the sections are inconsistent
+void restoreSnapshot(const snapshot::Mapping &m)
+{
+    metrics::ScopedTimer timer(restoreLatency);
+    int N = m.scalar<int>(NodesTag);
+    auto parents = m.array<int>(ParentTag);
+    auto tokens = m.array<std::uint8_t>(TokenTag);
+    auto offsets = m.array<std::uint32_t>(QueueOffsetTag);
+    auto ids = m.array<int>(QueueIdsTag);
+    if (N <= 0 || parents.size() != std::size_t(N) || tokens.size() != std::size_t(N) ||
+        offsets.size() != std::size_t(N) + 1 || offsets[0] != 0 || offsets[N] != ids.size())
+    {
+        throw std::runtime_error("Snapshot does not describe a Raymond tree");
+    }
+    for (int id : ids)
+    {
+        if (id < 1 || id > N)
+            throw std::runtime_error("Snapshot queue entry out of range");
+    }
+
+    nodes.resize(N);
+    for (int i = 1; i <= N; i++)
+    {
+        Node &n = nodes[i - 1];
+        n = Node(i);
+        n.parent = parents[i - 1];
+        n.hasToken = tokens[i - 1] != 0;
+        if (n.parent < 0 || n.parent > N || offsets[i - 1] > offsets[i])
+            throw std::runtime_error("Snapshot node entry out of range");
+        n.reserve(N);
+        for (std::uint32_t k = offsets[i - 1]; k < offsets[i]; ++k)
+            n.enqueue(ids[k]);
+    }
+}
+
 // Helper function to print the entire system state
 void printState()
 {
@@ -23,15 +147,17 @@ void printState()
     std::cout << "System state:\n";
     for (auto &n : nodes)
     {
-        std::cout << "P" << n.id << " | parent = " << (n.parent ? "P" + std::to_string(n.parent) : "none")
-                  << " | hasToken = " << (n.hasToken ? "T" : " ") << " | queue = [";
-        std::queue<int> tmp = n.q;
-        while (!tmp.empty())
+        std::cout << "P" << n.id << " | parent = ";
+        if (n.parent)
+            std::cout << "P" << n.parent;
+        else
+            std::cout << "none";
+        std::cout << " | hasToken = " << (n.hasToken ? "T" : " ") << " | queue = [";
+        for (std::size_t i = 0; i < n.q.size(); ++i)
         {
-            std::cout << "P" << tmp.front();
-            tmp.pop();
-            if (!tmp.empty())
+            if (i > 0)
                 std::cout << ", ";
+            std::cout << "P" << n.q[i];
         }
         std::cout << "]\n";
     }
@@ -53,9 +179,11 @@ int climbToTokenHolder(int requester)
             break;
         }
         std::cout << "P" << curr << " -> REQUEST -> P" << p << "\n";
-        nodes[p - 1].q.push(requester);
+        nodes[p - 1].enqueue(requester);
         // Reverse the edge so that curr now points directly to p
         nodes[curr - 1].parent = p;
+        requestMessages++;
+        edgeReversals++;
         curr = p;
     }
     return curr;
@@ -72,8 +200,7 @@ void receiveToken(int holder, int target)
     // Continue handing off until we reach the target
     while (!nodes[curr - 1].q.empty())
     {
-        int next = nodes[curr - 1].q.front();
-        nodes[curr - 1].q.pop();
+        int next = nodes[curr - 1].dequeue();
 
         if (next == curr)
         {
@@ -85,6 +212,8 @@ void receiveToken(int holder, int target)
         // Reverse the edge: curr now points to next
         nodes[curr - 1].parent = next;
         nodes[next - 1].hasToken = true;
+        tokenMessages++;
+        edgeReversals++;
         curr = next;
         if (curr == target)
             break;
@@ -93,7 +222,7 @@ void receiveToken(int holder, int target)
     // Remove any leftover self-request in the target's queue
     if (!nodes[target - 1].q.empty() && nodes[target - 1].q.front() == target)
     {
-        nodes[target - 1].q.pop();
+        nodes[target - 1].dequeue();
     }
 
     // target becomes the new root (token holder)
@@ -108,6 +237,8 @@ void receiveToken(int holder, int target)
 // Otherwise, it enqueues its request and triggers climb/receive logic
 void requestCS(int u)
 {
+    metrics::ScopedTimer timer(requestLatency);
+    csRequests++;
     std::cout << ">>> P" << u << " requests CS\n";
 
     // if node already has the token, enter CS immediately
@@ -115,11 +246,8 @@ void requestCS(int u)
     {
         std::cout << "P" << u << " already has token -> entering CS\n";
         // Clear any previous requests and simulate self handoff
-        while (!nodes[u - 1].q.empty())
-        {
-            nodes[u - 1].q.pop();
-        }
-        nodes[u - 1].q.push(u);
+        nodes[u - 1].clearQueue();
+        nodes[u - 1].enqueue(u);
 
         receiveToken(u, u);
         printState();
@@ -127,7 +255,7 @@ void requestCS(int u)
     }
 
     // Enqueue this node's request
-    nodes[u - 1].q.push(u);
+    nodes[u - 1].enqueue(u);
 
     // If this is the only pending request at u, climb to token holder and hand off
     if (nodes[u - 1].q.size() == 1)
@@ -141,25 +269,44 @@ void requestCS(int u)
 
 int main()
 {
-    int N;
-    std::cout << "Enter number of nodes N: ";
-    std::cin >> N;
-    nodes.resize(N);
-    for (int i = 1; i <= N; i++)
+    snapshot::Checkpoint cp = snapshot::Checkpoint::fromEnv();
+    if (cp.restorePath != nullptr)
     {
-        nodes[i - 1] = Node(i);
+        try
+        {
+            snapshot::Mapping restored(cp.restorePath, SnapshotKind);
+            restoreSnapshot(restored);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Restored " << nodes.size() << " nodes from " << cp.restorePath << "\n";
     }
+    else
+    {
+        int N;
+        std::cout << "Enter number of nodes N: ";
+        std::cin >> N;
+        nodes.resize(N);
+        for (int i = 1; i <= N; i++)
+        {
+            nodes[i - 1] = Node(i);
+            nodes[i - 1].reserve(N); // each queue holds every requester at most once
+        }
 
-    std::cout << "Enter ID of the node that initially has the token: ";
-    int root;
-    std::cin >> root;
-    nodes[root - 1].hasToken = true;
+        std::cout << "Enter ID of the node that initially has the token: ";
+        int root;
+        std::cin >> root;
+        nodes[root - 1].hasToken = true;
 
-    std::cout << "Enter parent for each node (0 if none):\n";
-    for (int i = 1; i <= N; i++)
-    {
-        std::cout << " Parent of P" << i << ": ";
-        std::cin >> nodes[i - 1].parent;
+        std::cout << "Enter parent for each node (0 if none):\n";
+        for (int i = 1; i <= N; i++)
+        {
+            std::cout << " Parent of P" << i << ": ";
+            std::cin >> nodes[i - 1].parent;
+        }
     }
 
     printState();
@@ -167,14 +314,30 @@ int main()
     int M;
     std::cout << "How many CS requests to simulate? ";
     std::cin >> M;
-    while (M--)
+    int requests = M;
+    std::size_t allocsBefore = alloc::count;
+    try
+    {
+        for (int done = 1; done <= requests; ++done)
+        {
+            int u;
+            std::cout << "\nRequesting node ID: P";
+            std::cin >> u;
+            requestCS(u);
+            if (cp.due(done))
+                saveSnapshot(cp.savePath);
+        }
+        if (cp.savePath != nullptr)
+            saveSnapshot(cp.savePath);
+    }
+    catch (const std::exception &e)
     {
-        int u;
-        std::cout << "\nRequesting node ID: P";
-        std::cin >> u;
-        requestCS(u);
+        std::cerr << e.what() << "\n";
+        return 1;
     }
+    std::cout << "operator new calls while serving " << requests << " requests: " << alloc::count - allocsBefore << "\n";
 
     std::cout << "Simulation complete.\n";
+    metrics::exportFromEnv();
     return 0;
 }
@@ -1,6 +1,11 @@
+#include "../../common/alloc_counter.h"
+#include "../../common/fixed.h"
+#include "../../common/metrics.h"
+#include "../../common/pool.h"
 #include <algorithm>
+#include <array>
+#include <iomanip>
 #include <iostream>
-#include <queue>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -19,7 +24,8 @@ enum class State
 enum class MessageType
 {
     Request,
-    Reply
+    Reply,
+    Token // Suzuki-Kasami token handover
 };
 
 struct Message
@@ -27,11 +33,24 @@ struct Message
     int from; // sender ID
     int to;   // receiver ID
     MessageType type;
-    int timestamp; // Lamport time of *sender*
+    int timestamp; // Lamport time of *sender* (Suzuki-Kasami: request sequence number)
 
+    Message() = default;
     Message(int f, int t, MessageType ty, int ts) : from(f), to(t), type(ty), timestamp(ts) {};
 };
 
+using Bus = RingQueue<Message>; // network queue, preallocated in main
+
+// Run metrics, exported at the end of main
+std::uint64_t &raMessages = metrics::counter("ra_messages_sent_total");
+std::uint64_t &raDeferred = metrics::counter("ra_deferred_requests_total");
+std::uint64_t &raEntries = metrics::counter("ra_cs_entries_total");
+metrics::Histogram &raHandleLatency = metrics::histogram("ra_message_handle_ns");
+std::uint64_t &skMessages = metrics::counter("sk_messages_sent_total");
+std::uint64_t &skTokenPasses = metrics::counter("sk_token_passes_total");
+std::uint64_t &skEntries = metrics::counter("sk_cs_entries_total");
+metrics::Histogram &skHandleLatency = metrics::histogram("sk_message_handle_ns");
+
 /* -------------------------  node behaviour  ------------------------- */
 
 struct Node
@@ -42,12 +61,23 @@ struct Node
     int requestTs = -1;         // Frozen timestamp of *my* request
     std::vector<bool> gotReply; // REPLY bitmap
     std::vector<int> deferred;  // Queued requesters
+    int pending = 0;            // local requests issued while already waiting
+    int entries = 0;            // CS entries so far
 
-    Node(int id, int N) : id(id), gotReply(N, false) {};
+    Node(int id, int N) : id(id), gotReply(N, false)
+    {
+        deferred.reserve(N);
+    };
 
     /* --- broadcasting REQUEST to every other node --- */
-    void broadcastRequest(std::queue<Message> &bus, int N)
+    void broadcastRequest(Bus &bus, int N)
     {
+        if (state != State::Released)
+        {
+            pending++; // broadcast again after leaving the CS
+            return;
+        }
+
         state = State::Wanted;
         clock++;           // Local event
         requestTs = clock; // Freeze timestamp
@@ -65,13 +95,49 @@ struct Node
             {
                 clock++; // Tick for each send
                 bus.emplace(id, i, MessageType::Request, requestTs);
+                raMessages++;
             }
         }
+
+        if (N == 1)
+        {
+            enterCS(bus, N); // nobody else to ask
+        }
+    }
+
+    /* --- every REPLY collected (or no other node) --- */
+    void enterCS(Bus &bus, int N)
+    {
+        state = State::Held;
+        entries++;
+        raEntries++;
+        std::cout << "[ENTER-CS] Node " << id << " @clk=" << clock << "\n";
+
+        // CRITICAL SECTION
+
+        state = State::Released;
+        std::cout << "[LEAVE-CS] Node " << id << " @clk=" << clock << "\n";
+
+        // Serve every deferred requester
+        for (int dst : deferred)
+        {
+            clock++;
+            bus.emplace(id, dst, MessageType::Reply, clock);
+            raMessages++;
+        }
+        deferred.clear();
+
+        if (pending > 0)
+        {
+            pending--;
+            broadcastRequest(bus, N);
+        }
     }
 
     /* --- handle an incoming message --- */
-    void recieveRequest(const Message &m, std::queue<Message> &bus, int N)
+    void recieveRequest(const Message &m, Bus &bus, int N)
     {
+        metrics::ScopedTimer timer(raHandleLatency);
         clock = std::max(clock, m.timestamp) + 1; // Lamport's rule
 
         if (VERBOSE)
@@ -101,21 +167,7 @@ struct Node
 
             if (state == State::Wanted && ok)
             {
-                state = State::Held;
-                std::cout << "[ENTER-CS] Node " << id << " @clk=" << clock << "\n";
-
-                // CRITICAL SECTION
-
-                state = State::Released;
-                std::cout << "[LEAVE-CS] Node " << id << " @clk=" << clock << "\n";
-
-                // Serve every deferred requester
-                for (int dst : deferred)
-                {
-                    clock++;
-                    bus.emplace(id, dst, MessageType::Reply, clock);
-                }
-                deferred.clear();
+                enterCS(bus, N);
             }
         }
         else /* ---- REQUEST ---- */
@@ -128,6 +180,7 @@ struct Node
             if (deferIt == true)
             {
                 deferred.push_back(m.from); // Answer later
+                raDeferred++;
                 if (VERBOSE)
                 {
                     std::cout << "[DEF] Node " << id << " defers REQ from " << m.from << "\n";
@@ -137,37 +190,427 @@ struct Node
             {
                 clock++; // Tick for send
                 bus.emplace(id, m.from, MessageType::Reply, clock);
+                raMessages++;
             }
         }
     }
 };
 
-int main()
+/* ----------------------  fixed-size node (N <= Cap)  ---------------------- */
+
+// Same protocol with array storage: outstanding REPLYs are one bit set,
+// deferred requests are counted per requester and answered in ID order
+template <int Cap> struct FixedNode
 {
-    std::size_t N, M;
-    std::cout << "Number of nodes (N): ";
-    std::cin >> N;
-    std::cout << "Number of CS requests (M): ";
-    std::cin >> M;
+    int id;
+    int clock = 0;
+    State state = State::Released;
+    int requestTs = -1;
+    fixed::BitRow<Cap> missingReply;      // REPLYs still to collect
+    fixed::BitRow<Cap> deferredFrom;      // requesters with deferredCount > 0
+    std::array<int, Cap> deferredCount{}; // queued requests per requester
+    int pending = 0;
+    int entries = 0;
+
+    FixedNode(int id, int) : id(id) {};
+
+    void broadcastRequest(Bus &bus, int N)
+    {
+        if (state != State::Released)
+        {
+            pending++;
+            return;
+        }
+
+        state = State::Wanted;
+        clock++;
+        requestTs = clock;
+        if (VERBOSE)
+        {
+            std::cout << "[REQ] Node " << id << " @ts=" << requestTs << "\n";
+        }
+
+        missingReply.clear();
+        for (int i = 0; i < N; ++i)
+        {
+            if (i != id)
+            {
+                missingReply.set(i);
+                clock++;
+                bus.emplace(id, i, MessageType::Request, requestTs);
+                raMessages++;
+            }
+        }
+
+        if (N == 1)
+        {
+            enterCS(bus, N); // nobody else to ask
+        }
+    }
 
-    std::vector<Node> nodes;
+    void enterCS(Bus &bus, int N)
+    {
+        state = State::Held;
+        entries++;
+        raEntries++;
+        std::cout << "[ENTER-CS] Node " << id << " @clk=" << clock << "\n";
+
+        // CRITICAL SECTION
+
+        state = State::Released;
+        std::cout << "[LEAVE-CS] Node " << id << " @clk=" << clock << "\n";
+
+        for (int dst = deferredFrom.first(); dst >= 0; dst = deferredFrom.first())
+        {
+            for (; deferredCount[dst] > 0; deferredCount[dst]--)
+            {
+                clock++;
+                bus.emplace(id, dst, MessageType::Reply, clock);
+                raMessages++;
+            }
+            deferredFrom.reset(dst);
+        }
+
+        if (pending > 0)
+        {
+            pending--;
+            broadcastRequest(bus, N);
+        }
+    }
+
+    void recieveRequest(const Message &m, Bus &bus, int N)
+    {
+        metrics::ScopedTimer timer(raHandleLatency);
+        clock = std::max(clock, m.timestamp) + 1;
+
+        if (VERBOSE)
+        {
+            std::cout << "[MSG] Node " << id << " got " << (m.type == MessageType::Request ? "REQ" : "REP") << " from "
+                      << m.from << " @msgTs=" << m.timestamp << "\n";
+        }
+
+        if (m.type == MessageType::Reply)
+        {
+            missingReply.reset(m.from);
+            if (state == State::Wanted && !missingReply.any())
+            {
+                enterCS(bus, N);
+            }
+        }
+        else
+        {
+            auto his = std::tie(m.timestamp, m.from);
+            auto mine = std::tie(requestTs, id);
+
+            if ((state == State::Held) || (state == State::Wanted && his > mine))
+            {
+                deferredCount[m.from]++;
+                deferredFrom.set(m.from);
+                raDeferred++;
+                if (VERBOSE)
+                {
+                    std::cout << "[DEF] Node " << id << " defers REQ from " << m.from << "\n";
+                }
+            }
+            else
+            {
+                clock++;
+                bus.emplace(id, m.from, MessageType::Reply, clock);
+                raMessages++;
+            }
+        }
+    }
+};
+
+/* -------------------  Suzuki-Kasami token algorithm  ------------------- */
+
+// The single privilege token: LN[j] = sequence number of j's last served request
+struct Token
+{
+    std::vector<int> LN;
+    RingQueue<int> Q;      // nodes waiting for the token
+    std::vector<bool> inQ; // membership bitmap for Q
+    int holder = 0;        // node currently owning the token (-1 while in transit)
+
+    Token(int N) : LN(N, 0), inQ(N, false)
+    {
+        Q.reserve(N);
+    };
+};
+
+struct SKNode
+{
+    int id;
+    State state = State::Released;
+    std::vector<int> RN; // RN[j] = highest request number received from j
+    int pending = 0;     // local requests issued while already waiting
+    int entries = 0;     // CS entries so far
+
+    SKNode(int id, int N) : id(id), RN(N, 0) {};
+
+    void sendToken(Bus &bus, Token &token, int dst)
+    {
+        token.holder = -1; // in transit
+        bus.emplace(id, dst, MessageType::Token, 0);
+        skMessages++;
+        skTokenPasses++;
+    }
+
+    /* --- ask for the CS: free with the token, N-1 REQUESTs otherwise --- */
+    void requestCS(Bus &bus, Token &token, int N)
+    {
+        if (state != State::Released)
+        {
+            pending++; // served after the current request
+            return;
+        }
+
+        state = State::Wanted;
+        if (token.holder == id)
+        {
+            enterCS(bus, token, N);
+            return;
+        }
+        broadcastRequest(bus, N);
+    }
+
+    void broadcastRequest(Bus &bus, int N)
+    {
+        RN[id]++;
+        if (VERBOSE)
+        {
+            std::cout << "[REQ] Node " << id << " sn=" << RN[id] << "\n";
+        }
+        for (int i = 0; i < N; ++i)
+        {
+            if (i != id)
+            {
+                bus.emplace(id, i, MessageType::Request, RN[id]);
+                skMessages++;
+            }
+        }
+    }
+
+    // Runs the CS, then serves queued local requests in a loop while the token stays here
+    // and broadcasts for the next one once it has moved on
+    void enterCS(Bus &bus, Token &token, int N)
+    {
+        runCS(bus, token, N);
+        while (pending > 0 && token.holder == id)
+        {
+            pending--;
+            runCS(bus, token, N);
+        }
+        if (pending > 0)
+        {
+            pending--;
+            state = State::Wanted;
+            broadcastRequest(bus, N);
+        }
+    }
+
+    void runCS(Bus &bus, Token &token, int N)
+    {
+        state = State::Held;
+        entries++;
+        skEntries++;
+        std::cout << "[ENTER-CS] Node " << id << " sn=" << RN[id] << "\n";
+
+        // CRITICAL SECTION
+
+        state = State::Released;
+        std::cout << "[LEAVE-CS] Node " << id << "\n";
+
+        // Append every node with an outstanding request to the token queue
+        token.LN[id] = RN[id];
+        for (int j = 0; j < N; ++j)
+        {
+            if (!token.inQ[j] && RN[j] == token.LN[j] + 1)
+            {
+                token.Q.push(j);
+                token.inQ[j] = true;
+            }
+        }
+        if (!token.Q.empty())
+        {
+            int next = token.Q.front();
+            token.Q.pop();
+            token.inQ[next] = false;
+            sendToken(bus, token, next);
+        }
+    }
+
+    /* --- handle an incoming message --- */
+    void receive(const Message &m, Bus &bus, Token &token, int N)
+    {
+        metrics::ScopedTimer timer(skHandleLatency);
+        if (VERBOSE)
+        {
+            std::cout << "[MSG] Node " << id << " got " << (m.type == MessageType::Request ? "REQ" : "TOKEN")
+                      << " from " << m.from << "\n";
+        }
+
+        if (m.type == MessageType::Token)
+        {
+            token.holder = id;
+            enterCS(bus, token, N);
+            return;
+        }
+
+        RN[m.from] = std::max(RN[m.from], m.timestamp);
+        if (token.holder == id && state == State::Released && RN[m.from] == token.LN[m.from] + 1)
+        {
+            sendToken(bus, token, m.from);
+        }
+    }
+};
+
+/* ---------------------------  simulation  --------------------------- */
+
+struct RunStats
+{
+    std::size_t messages = 0;
+    int entries = 0;
+    double micros = 0; // one run with the console muted
+};
+
+// k % N round-robin workload: every request is issued up front, then the bus drains
+template <class NodeT> RunStats runRicartAgrawala(int N, int M)
+{
+    std::vector<NodeT> nodes;
     nodes.reserve(N);
-    for (std::size_t i = 0; i < N; ++i)
+    for (int i = 0; i < N; ++i)
     {
         nodes.emplace_back(i, N);
     }
 
-    std::queue<Message> bus; // global *network* queue
+    Bus bus; // global *network* queue
+    // At most one outstanding request per node, each costs at most 2(N-1) messages in flight
+    bus.reserve(2 * std::size_t(std::min(M, N)) * std::size_t(N - 1));
 
-    for (std::size_t k = 0; k < M; ++k)
+    RunStats stats;
+    for (int k = 0; k < M; ++k)
     {
         nodes[k % N].broadcastRequest(bus, N);
     }
 
+    std::size_t allocsBefore = alloc::count;
+    std::size_t delivered = 0; // every message sent is delivered once
     while (bus.empty() == false)
     {
-        Message m = bus.front();
+        const Message m = bus.front(); // trivially copyable, bus may wrap while handling it
         bus.pop();
         nodes[m.to].recieveRequest(m, bus, N);
+        delivered++;
+    }
+    std::cout << "operator new calls while delivering " << delivered << " messages: " << alloc::count - allocsBefore
+              << "\n";
+
+    stats.messages = delivered;
+    for (const NodeT &n : nodes)
+    {
+        stats.entries += n.entries;
+    }
+    return stats;
+}
+
+RunStats runSuzukiKasami(int N, int M)
+{
+    std::vector<SKNode> nodes;
+    nodes.reserve(N);
+    for (int i = 0; i < N; ++i)
+    {
+        nodes.emplace_back(i, N);
+    }
+    Token token(N); // initially held by node 0
+
+    Bus bus;
+    // At most one outstanding request per node plus the token
+    bus.reserve(std::size_t(N) * std::size_t(N) + 1);
+
+    RunStats stats;
+    std::size_t allocsBefore = alloc::count;
+    for (int k = 0; k < M; ++k)
+    {
+        nodes[k % N].requestCS(bus, token, N);
+    }
+
+    while (bus.empty() == false)
+    {
+        const Message m = bus.front();
+        bus.pop();
+        nodes[m.to].receive(m, bus, token, N);
+        stats.messages++;
+    }
+    std::cout << "operator new calls while delivering " << stats.messages
+              << " messages: " << alloc::count - allocsBefore << "\n";
+
+    for (const SKNode &n : nodes)
+    {
+        stats.entries += n.entries;
+    }
+    return stats;
+}
+
+// Smallest fixed-size node that fits N, the vector-based node beyond that
+RunStats runRicartAgrawalaBest(int N, int M)
+{
+    RunStats stats;
+    auto run = [&](auto cap) {
+        constexpr int Cap = decltype(cap)::value;
+        stats = runRicartAgrawala<FixedNode<Cap>>(N, M);
+    };
+    if (!fixed::dispatch(N, run))
+    {
+        stats = runRicartAgrawala<Node>(N, M);
+    }
+    return stats;
+}
+
+void printRow(const char *name, const RunStats &s)
+{
+    std::cout << std::left << std::setw(16) << name << std::right << std::setw(10) << s.messages << std::setw(12)
+              << s.entries << std::setw(10) << std::fixed << std::setprecision(2)
+              << (s.entries ? double(s.messages) / s.entries : 0.0) << std::setw(14)
+              << (s.micros > 0 ? s.entries / (s.micros / 1000.0) : 0.0) << "\n";
+}
+
+int main()
+{
+    int N, M;
+    std::cout << "Number of nodes (N): ";
+    std::cin >> N;
+    std::cout << "Number of CS requests (M): ";
+    std::cin >> M;
+    if (N <= 0 || M < 0)
+    {
+        std::cerr << "Invalid N or M.\n";
+        return 1;
+    }
+
+    std::cout << "\n=== Ricart-Agrawala ===\n";
+    RunStats ra = runRicartAgrawalaBest(N, M);
+    std::cout << "\n=== Suzuki-Kasami ===\n";
+    RunStats sk = runSuzukiKasami(N, M);
+
+    // Timing reruns below would inflate the counters, export what the traced run recorded
+    metrics::Registry runMetrics = metrics::snapshot();
+
+    // Throughput comes from muted reruns, the trace above would dominate the timing
+    ra.micros = fixed::benchMicros(1, [&] { runRicartAgrawalaBest(N, M); });
+    sk.micros = fixed::benchMicros(1, [&] { runSuzukiKasami(N, M); });
+
+    std::cout << "\n" << std::left << std::setw(16) << "Algorithm" << std::right << std::setw(10) << "Messages"
+              << std::setw(12) << "CS entries" << std::setw(10) << "Msg/CS" << std::setw(14) << "CS per ms"
+              << "\n";
+    printRow("Ricart-Agrawala", ra);
+    printRow("Suzuki-Kasami", sk);
+
+    if (int reps = fixed::benchRepetitions())
+    {
+        double genericUs = fixed::benchMicros(reps, [&] { runRicartAgrawala<Node>(N, M); });
+        double fixedUs = fixed::benchMicros(reps, [&] { runRicartAgrawalaBest(N, M); });
+        fixed::report("Ricart-Agrawala run", N, reps, genericUs, fixedUs);
     }
+    metrics::exportFromEnv(runMetrics);
 }
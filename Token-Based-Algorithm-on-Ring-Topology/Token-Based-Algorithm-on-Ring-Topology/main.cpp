@@ -1,6 +1,58 @@
+#include "../../common/alloc_counter.h"
+#include "../../common/fixed.h"
+#include "../../common/metrics.h"
+#include "../../common/pool.h"
+#include "../../common/snapshot.h"
+#include <array>
 #include <iostream>
-#include <queue>
+#include <optional>
 #include <stdexcept>
+#include <vector>
+
+// Run metrics, exported at the end of main
+std::uint64_t &requestsTotal = metrics::counter("token_ring_requests_total");
+std::uint64_t &searchSteps = metrics::counter("token_ring_owner_search_steps_total");
+std::uint64_t &ringHops = metrics::counter("token_ring_hops_total");
+metrics::Histogram &processLatency = metrics::histogram("token_ring_process_token_ns");
+metrics::Histogram &saveLatency = metrics::histogram("token_ring_snapshot_save_ns");
+metrics::Histogram &restoreLatency = metrics::histogram("token_ring_snapshot_restore_ns");
+
+// Snapshot layout, shared by both ring types: node IDs in ring order starting at the head,
+// the token owner and the pending requests front first
+constexpr std::uint32_t SnapshotKind = snapshot::code("TRNG");
+constexpr std::uint32_t NodesTag = snapshot::code("nnod");
+constexpr std::uint32_t OwnerTag = snapshot::code("ownr");
+constexpr std::uint32_t RingTag = snapshot::code("ring");
+constexpr std::uint32_t QueueTag = snapshot::code("reqq");
+
+// Restored ring, checked to be a permutation of 0..N-1 with valid owner and requests
+struct RingImage
+{
+    snapshot::View<int> ring, queue;
+    int owner;
+
+    explicit RingImage(const snapshot::Mapping &m)
+        : ring(m.array<int>(RingTag)), queue(m.array<int>(QueueTag)), owner(m.scalar<int>(OwnerTag))
+    {
+        int N = m.scalar<int>(NodesTag);
+        if (N <= 0 || ring.size() != std::size_t(N) || owner < 0 || owner >= N)
+        {
+            throw std::invalid_argument("Snapshot does not describe a token ring");
+        }
+        std::vector<bool> seen(N, false);
+        for (int id : ring)
+        {
+            if (id < 0 || id >= N || seen[id])
+                throw std::invalid_argument("Snapshot ring is not a permutation of node IDs");
+            seen[id] = true;
+        }
+        for (int id : queue)
+        {
+            if (id < 0 || id >= N)
+                throw std::invalid_argument("Snapshot request out of range");
+        }
+    }
+};
 
 class TokenRing
 {
@@ -14,12 +66,13 @@ class TokenRing
 
     struct Token
     {
-        int currentOwner = -1;        // ID of node holding the token
-        std::queue<int> requestQueue; // queue of pending token requests
+        int currentOwner = -1;       // ID of node holding the token
+        RingQueue<int> requestQueue; // queue of pending token requests
     };
 
-    Node *head = new Node(0, nullptr); // start of the ring
-    Token coin;                        // token held in the ring
+    ObjectPool<Node> pool; // storage for all ring nodes
+    Node *head = nullptr;  // start of the ring
+    Token coin;            // token held in the ring
 
   public:
     // Build a ring of N nodes and set initial token owner
@@ -30,6 +83,8 @@ class TokenRing
             throw std::invalid_argument("Wrong N or token owner ID");
         }
 
+        pool.reserve(N);
+        head = pool.create(0, nullptr);
         Node *curr = head;
 
         // set token owner if it's the head node
@@ -41,7 +96,7 @@ class TokenRing
         // create remaining nodes and assign tokenOwner when found
         for (int id = 1; id < N; ++id)
         {
-            curr->next = new Node(id, nullptr);
+            curr->next = pool.create(id, nullptr);
             if (id == tokenOwner)
             {
                 coin.currentOwner = id;
@@ -52,6 +107,66 @@ class TokenRing
         curr->next = head; // close the ring
     }
 
+    // Size the request queue up front so queuing never reallocates
+    void reserveRequests(int M)
+    {
+        coin.requestQueue.reserve(M);
+    }
+
+    std::size_t pending() const
+    {
+        return coin.requestQueue.size();
+    }
+
+    void save(snapshot::Writer &w) const
+    {
+        int n = 0;
+        Node *curr = head;
+        do
+        {
+            n++;
+            curr = curr->next;
+        } while (curr != head);
+
+        w.scalar(NodesTag, n);
+        w.scalar(OwnerTag, coin.currentOwner);
+        w.begin<int>(RingTag);
+        do
+        {
+            w.value(curr->ID);
+            curr = curr->next;
+        } while (curr != head);
+        w.end();
+        w.begin<int>(QueueTag);
+        for (std::size_t i = 0; i < coin.requestQueue.size(); ++i)
+        {
+            w.value(coin.requestQueue[i]);
+        }
+        w.end();
+    }
+
+    // Rebuilds the ring in the saved order, replaces createStructure()
+    void restore(const snapshot::Mapping &m)
+    {
+        RingImage img(m);
+        pool.reserve(img.ring.size());
+        head = pool.create(img.ring[0], nullptr);
+        Node *curr = head;
+        for (std::size_t i = 1; i < img.ring.size(); ++i)
+        {
+            curr->next = pool.create(img.ring[i], nullptr);
+            curr = curr->next;
+        }
+        curr->next = head;
+
+        coin.currentOwner = img.owner;
+        coin.requestQueue.reserve(img.queue.size());
+        for (int id : img.queue)
+        {
+            coin.requestQueue.push(id);
+        }
+    }
+
     // Print ring structure and token state
     void printTokenRing() const
     {
@@ -66,12 +181,10 @@ class TokenRing
 
         if (!coin.requestQueue.empty())
         {
-            std::queue<int> toPrint = coin.requestQueue;
             std::cout << "Remaining queue: [";
-            while (!toPrint.empty())
+            for (std::size_t i = 0; i < coin.requestQueue.size(); ++i)
             {
-                std::cout << toPrint.front() << " ";
-                toPrint.pop();
+                std::cout << coin.requestQueue[i] << " ";
             }
             std::cout << "]\n";
         }
@@ -86,6 +199,7 @@ class TokenRing
             if (curr->ID == coin.currentOwner)
             {
                 coin.requestQueue.push(requesterID);
+                requestsTotal++;
                 std::cout << "Node " << requesterID << " has been added to queue.\n";
                 return;
             }
@@ -98,6 +212,7 @@ class TokenRing
     // Process one token pass: dequeue request, circulate token, enter CS
     void processToken()
     {
+        metrics::ScopedTimer timer(processLatency);
         if (coin.requestQueue.empty())
         {
             std::cout << "No pending requests. Token stays with Node " << coin.currentOwner << ".\n";
@@ -112,6 +227,7 @@ class TokenRing
         while (curr->ID != coin.currentOwner)
         {
             curr = curr->next;
+            searchSteps++;
         }
 
         // pass token along until it reaches the next owner
@@ -119,6 +235,7 @@ class TokenRing
         {
             std::cout << "Passing token from " << curr->ID << " -> " << curr->next->ID << "\n";
             curr = curr->next;
+            ringHops++;
         }
 
         coin.currentOwner = nextTokenOwner; // update token ownership
@@ -127,31 +244,219 @@ class TokenRing
 
         // display remaining requests
         std::cout << "Remaining queue: [";
-        std::queue<int> temp = coin.requestQueue;
-        while (!temp.empty())
+        for (std::size_t i = 0; i < coin.requestQueue.size(); ++i)
         {
-            std::cout << temp.front() << " ";
-            temp.pop();
+            std::cout << coin.requestQueue[i] << " ";
         }
         std::cout << "]\n";
     }
 };
 
-int main()
+// Fixed-size ring for up to Cap nodes: next[] replaces the node list and the owner is
+// reached directly instead of walking the ring from the head
+template <int Cap> class FixedTokenRing
 {
-    int N;
-    std::cout << "Enter size of ring: ";
-    std::cin >> N;
-    TokenRing TR;
+    int N = 0;
+    std::array<int, Cap> next{}; // next[i] = successor of node i
+    int currentOwner = -1;
+    RingQueue<int> requestQueue;
 
-    std::cout << "\nEnter ID of token owner: ";
-    int tokenOwner;
-    std::cin >> tokenOwner;
+    void printQueue() const
+    {
+        for (std::size_t i = 0; i < requestQueue.size(); ++i)
+        {
+            std::cout << requestQueue[i] << " ";
+        }
+    }
 
-    try
+  public:
+    void createStructure(int n, int tokenOwner)
+    {
+        if (n <= 0 || n > Cap || tokenOwner >= n)
+        {
+            throw std::invalid_argument("Wrong N or token owner ID");
+        }
+        N = n;
+        for (int id = 0; id < N; ++id)
+        {
+            next[id] = id + 1 < N ? id + 1 : 0;
+        }
+        currentOwner = tokenOwner;
+    }
+
+    void reserveRequests(int M)
+    {
+        requestQueue.reserve(M);
+    }
+
+    std::size_t pending() const
+    {
+        return requestQueue.size();
+    }
+
+    // Node 0 plays the head of the linked ring
+    void save(snapshot::Writer &w) const
+    {
+        w.scalar(NodesTag, N);
+        w.scalar(OwnerTag, currentOwner);
+        w.begin<int>(RingTag);
+        int curr = 0;
+        do
+        {
+            w.value(curr);
+            curr = next[curr];
+        } while (curr != 0);
+        w.end();
+        w.begin<int>(QueueTag);
+        for (std::size_t i = 0; i < requestQueue.size(); ++i)
+        {
+            w.value(requestQueue[i]);
+        }
+        w.end();
+    }
+
+    void restore(const snapshot::Mapping &m)
+    {
+        RingImage img(m);
+        if (img.ring.size() > std::size_t(Cap))
+        {
+            throw std::invalid_argument("Snapshot ring does not fit");
+        }
+        N = static_cast<int>(img.ring.size());
+        for (int i = 0; i < N; ++i)
+        {
+            next[img.ring[i]] = img.ring[(i + 1) % N];
+        }
+        currentOwner = img.owner;
+        requestQueue.reserve(img.queue.size());
+        for (int id : img.queue)
+        {
+            requestQueue.push(id);
+        }
+    }
+
+    void printTokenRing() const
+    {
+        for (int id = 0; id < N; ++id)
+        {
+            std::cout << "ID: " << id << " next->ID:" << next[id] << "\n";
+        }
+        std::cout << "ID of Node which has token: " << currentOwner << "\n";
+        if (!requestQueue.empty())
+        {
+            std::cout << "Remaining queue: [";
+            printQueue();
+            std::cout << "]\n";
+        }
+    }
+
+    void sendRequest(int requesterID)
+    {
+        if (currentOwner < 0)
+        {
+            throw std::runtime_error("Token owner not found.\n");
+        }
+        requestQueue.push(requesterID);
+        requestsTotal++;
+        std::cout << "Node " << requesterID << " has been added to queue.\n";
+    }
+
+    void processToken()
+    {
+        metrics::ScopedTimer timer(processLatency);
+        if (requestQueue.empty())
+        {
+            std::cout << "No pending requests. Token stays with Node " << currentOwner << ".\n";
+            return;
+        }
+
+        int nextTokenOwner = requestQueue.front();
+        requestQueue.pop();
+
+        for (int curr = currentOwner; curr != nextTokenOwner; curr = next[curr])
+        {
+            std::cout << "Passing token from " << curr << " -> " << next[curr] << "\n";
+            ringHops++;
+        }
+
+        currentOwner = nextTokenOwner;
+        std::cout << "Token received by Node " << nextTokenOwner << " (new Phold)\n";
+        std::cout << "Entering CS\n";
+
+        std::cout << "Remaining queue: [";
+        printQueue();
+        std::cout << "]\n";
+    }
+};
+
+template <class Ring> void saveSnapshot(const Ring &TR, const char *path)
+{
+    metrics::ScopedTimer timer(saveLatency);
+    snapshot::Writer w(path, SnapshotKind);
+    TR.save(w);
+    w.commit();
+}
+
+// Either builds a fresh ring or restores a saved one
+template <class Ring> void prepareRing(Ring &TR, int N, int tokenOwner, const snapshot::Mapping *restored)
+{
+    if (restored != nullptr)
+    {
+        metrics::ScopedTimer timer(restoreLatency);
+        TR.restore(*restored);
+    }
+    else
     {
         TR.createStructure(N, tokenOwner); // build ring and assign initial holder
     }
+}
+
+// Queues every request, then serves them (and any restored ones) in FIFO order
+// Checkpoints as configured by `cp`, none when null
+template <class Ring>
+void serveRequests(Ring &TR, const std::vector<int> &requests, const snapshot::Checkpoint *cp)
+{
+    TR.reserveRequests(static_cast<int>(TR.pending() + requests.size()));
+    for (int requesterID : requests)
+    {
+        TR.sendRequest(requesterID);
+    }
+
+    TR.printTokenRing();
+
+    std::cout << "\n--- Processing token requests ---\n";
+    std::size_t pending = TR.pending();
+    std::size_t allocsBefore = alloc::count;
+    for (std::size_t done = 1; done <= pending; ++done)
+    {
+        TR.processToken(); // serve each request in FIFO order
+        if (cp != nullptr && cp->due(done))
+        {
+            saveSnapshot(TR, cp->savePath);
+        }
+    }
+    std::cout << "operator new calls while processing " << pending << " requests: " << alloc::count - allocsBefore
+              << "\n";
+
+    std::cout << "\nFinal state:\n";
+    TR.printTokenRing();
+
+    if (cp != nullptr && cp->savePath != nullptr)
+    {
+        saveSnapshot(TR, cp->savePath);
+    }
+}
+
+// Interactive run on one ring type, the request IDs are kept for the benchmark
+template <class Ring>
+int simulate(int N, int tokenOwner, const snapshot::Mapping *restored, const snapshot::Checkpoint &cp,
+             std::vector<int> &requests)
+{
+    Ring TR;
+    try
+    {
+        prepareRing(TR, N, tokenOwner, restored);
+    }
     catch (const std::exception &e)
     {
         std::cout << e.what();
@@ -167,20 +472,101 @@ int main()
     {
         int requesterID;
         std::cin >> requesterID;
-        TR.sendRequest(requesterID); // collect all requests
+        requests.push_back(requesterID); // collect all requests
     }
 
-    TR.printTokenRing();
+    try
+    {
+        serveRequests(TR, requests, &cp);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-    std::cout << "\n--- Processing token requests ---\n";
-    for (int i = 0; i < M; ++i)
+// Runs f on the smallest fixed-size ring that fits N, on the linked ring beyond that
+template <class F> void withBestRing(int N, F &&f)
+{
+    auto run = [&](auto cap) {
+        constexpr int Cap = decltype(cap)::value;
+        FixedTokenRing<Cap> TR;
+        f(TR);
+    };
+    if (!fixed::dispatch(N, run))
     {
-        TR.processToken(); // serve each request in FIFO order
+        TokenRing TR;
+        f(TR);
     }
+}
 
-    std::cout << "\nFinal state:\n";
-    TR.printTokenRing();
+int main()
+{
+    snapshot::Checkpoint cp = snapshot::Checkpoint::fromEnv();
+    std::optional<snapshot::Mapping> restored;
+
+    int N;
+    int tokenOwner = 0;
+    if (cp.restorePath != nullptr)
+    {
+        try
+        {
+            restored.emplace(cp.restorePath, SnapshotKind);
+            N = restored->scalar<int>(NodesTag);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Restored ring of " << N << " nodes from " << cp.restorePath << "\n";
+    }
+    else
+    {
+        std::cout << "Enter size of ring: ";
+        std::cin >> N;
+
+        std::cout << "\nEnter ID of token owner: ";
+        std::cin >> tokenOwner;
+    }
+    const snapshot::Mapping *from = restored ? &*restored : nullptr;
+
+    std::vector<int> requests;
+    int status = 0;
+    auto run = [&](auto cap) {
+        constexpr int Cap = decltype(cap)::value;
+        status = simulate<FixedTokenRing<Cap>>(N, tokenOwner, from, cp, requests);
+    };
+    if (!fixed::dispatch(N, run))
+    {
+        status = simulate<TokenRing>(N, tokenOwner, from, cp, requests);
+    }
+    if (status != 0)
+    {
+        return status;
+    }
 
     std::cout << "Simulation complete.\n";
+
+    // Repetitions below would inflate the counters, export what the real run recorded
+    metrics::Registry runMetrics = metrics::snapshot();
+    if (int reps = fixed::benchRepetitions())
+    {
+        double genericUs = fixed::benchMicros(reps, [&] {
+            TokenRing TR;
+            prepareRing(TR, N, tokenOwner, from);
+            serveRequests(TR, requests, nullptr);
+        });
+        double fixedUs = fixed::benchMicros(reps, [&] {
+            withBestRing(N, [&](auto &TR) {
+                prepareRing(TR, N, tokenOwner, from);
+                serveRequests(TR, requests, nullptr);
+            });
+        });
+        fixed::report("token processing", N, reps, genericUs, fixedUs);
+    }
+    metrics::exportFromEnv(runMetrics);
     return 0;
 }
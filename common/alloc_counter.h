@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Replaces global operator new/delete to count heap allocations
+// Every form of operator new is counted (plain, array, nothrow, aligned), allocations that
+// bypass it (malloc, fopen and the rest of the C library) are not
+// Defines non-inline functions: include from exactly one translation unit per program
+
+namespace alloc
+{
+inline std::size_t count = 0; // number of operator new calls so far
+
+inline void *alignedMalloc(std::size_t bytes, std::size_t align)
+{
+    // aligned_alloc wants a non-zero multiple of the alignment
+    bytes = (bytes + align - 1) / align * align;
+#ifdef _MSC_VER
+    return _aligned_malloc(bytes ? bytes : align, align);
+#else
+    return std::aligned_alloc(align, bytes ? bytes : align);
+#endif
+}
+
+inline void alignedFree(void *p)
+{
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+} // namespace alloc
+
+void *operator new(std::size_t bytes)
+{
+    ++alloc::count;
+    if (void *p = std::malloc(bytes ? bytes : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t bytes)
+{
+    return ::operator new(bytes);
+}
+
+void *operator new(std::size_t bytes, const std::nothrow_t &) noexcept
+{
+    ++alloc::count;
+    return std::malloc(bytes ? bytes : 1);
+}
+
+void *operator new[](std::size_t bytes, const std::nothrow_t &tag) noexcept
+{
+    return ::operator new(bytes, tag);
+}
+
+void *operator new(std::size_t bytes, std::align_val_t align)
+{
+    ++alloc::count;
+    if (void *p = alloc::alignedMalloc(bytes, static_cast<std::size_t>(align)))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t align)
+{
+    return ::operator new(bytes, align);
+}
+
+void *operator new(std::size_t bytes, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    ++alloc::count;
+    return alloc::alignedMalloc(bytes, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t bytes, std::align_val_t align, const std::nothrow_t &tag) noexcept
+{
+    return ::operator new(bytes, align, tag);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    alloc::alignedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    alloc::alignedFree(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    alloc::alignedFree(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    alloc::alignedFree(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    alloc::alignedFree(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    alloc::alignedFree(p);
+}
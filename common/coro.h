@@ -0,0 +1,269 @@
+#pragma once
+
+#include "pool.h"
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// C++20 coroutine execution layer: every node is a coroutine written as a sequential
+// `co_await receive()` / `co_await send()` routine, resumed by a single-threaded scheduler
+
+namespace coro
+{
+
+// Coroutine frames are carved from large chunks and recycled per size class,
+// so a million nodes cost a million frames and no per-node malloc
+class FrameAllocator
+{
+    static constexpr std::size_t ChunkBytes = 1 << 20;
+
+    struct FreeList
+    {
+        std::size_t size;
+        void *head;
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    std::size_t used = ChunkBytes;
+    std::vector<FreeList> freeLists;
+
+  public:
+    std::size_t frameBytes = 0; // size of the last frame allocated
+
+    static FrameAllocator &instance()
+    {
+        static FrameAllocator alloc;
+        return alloc;
+    }
+
+    void *allocate(std::size_t bytes)
+    {
+        frameBytes = bytes;
+        bytes = (bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        for (FreeList &fl : freeLists)
+        {
+            if (fl.size == bytes && fl.head != nullptr)
+            {
+                void *p = fl.head;
+                fl.head = *static_cast<void **>(p);
+                return p;
+            }
+        }
+        if (bytes > ChunkBytes)
+        {
+            return ::operator new(bytes);
+        }
+        if (used + bytes > ChunkBytes)
+        {
+            chunks.emplace_back(new std::byte[ChunkBytes]);
+            used = 0;
+        }
+        void *p = chunks.back().get() + used;
+        used += bytes;
+        return p;
+    }
+
+    void deallocate(void *p, std::size_t bytes)
+    {
+        bytes = (bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        if (bytes > ChunkBytes)
+        {
+            ::operator delete(p);
+            return;
+        }
+        for (FreeList &fl : freeLists)
+        {
+            if (fl.size == bytes)
+            {
+                *static_cast<void **>(p) = fl.head;
+                fl.head = p;
+                return;
+            }
+        }
+        *static_cast<void **>(p) = nullptr;
+        freeLists.push_back({bytes, p});
+    }
+};
+
+// Fire-and-forget node routine, runs eagerly until its first suspension
+class Task
+{
+  public:
+    struct promise_type
+    {
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void()
+        {
+        }
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+
+        static void *operator new(std::size_t bytes)
+        {
+            return FrameAllocator::instance().allocate(bytes);
+        }
+        static void operator delete(void *p, std::size_t bytes)
+        {
+            FrameAllocator::instance().deallocate(p, bytes);
+        }
+    };
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {};
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {};
+    Task &operator=(Task &&other) noexcept
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool done() const
+    {
+        return handle.done();
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Per-node mailboxes plus the ready queue of the scheduler
+// Msg must be default constructible, envelopes come from a fixed pool
+template <class Msg> class Network
+{
+    struct Envelope
+    {
+        Msg msg;
+        Envelope *next = nullptr;
+    };
+
+    struct Mailbox
+    {
+        Envelope *head = nullptr;
+        Envelope *tail = nullptr;
+        std::coroutine_handle<> waiter; // node suspended in receive()
+    };
+
+    std::vector<Mailbox> boxes;
+    ObjectPool<Envelope> envelopes;
+    RingQueue<std::coroutine_handle<>> ready;
+
+    Msg pop(int self)
+    {
+        Mailbox &box = boxes[self];
+        Envelope *e = box.head;
+        box.head = e->next;
+        if (box.head == nullptr)
+        {
+            box.tail = nullptr;
+        }
+        Msg m = e->msg;
+        envelopes.destroy(e);
+        return m;
+    }
+
+  public:
+    std::size_t delivered = 0;
+
+    Network(std::size_t nodes, std::size_t maxInFlight) : boxes(nodes), envelopes(maxInFlight)
+    {
+        ready.reserve(nodes);
+    };
+
+    // Enqueue a message and wake the receiver if it is waiting
+    void post(int to, const Msg &msg)
+    {
+        Envelope *e = envelopes.create();
+        e->msg = msg;
+        Mailbox &box = boxes[to];
+        (box.tail ? box.tail->next : box.head) = e;
+        box.tail = e;
+        if (box.waiter)
+        {
+            ready.push(std::exchange(box.waiter, nullptr));
+        }
+    }
+
+    struct ReceiveAwaiter
+    {
+        Network &net;
+        int self;
+
+        bool await_ready() const
+        {
+            return net.boxes[self].head != nullptr;
+        }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            net.boxes[self].waiter = h;
+        }
+        Msg await_resume()
+        {
+            net.delivered++;
+            return net.pop(self);
+        }
+    };
+
+    // Sends never block, the awaiter only keeps node code uniform
+    struct SendAwaiter
+    {
+        bool await_ready() const
+        {
+            return true;
+        }
+        void await_suspend(std::coroutine_handle<>)
+        {
+        }
+        void await_resume()
+        {
+        }
+    };
+
+    ReceiveAwaiter receive(int self)
+    {
+        return ReceiveAwaiter{*this, self};
+    }
+
+    SendAwaiter send(int to, const Msg &msg)
+    {
+        post(to, msg);
+        return {};
+    }
+
+    // Resume ready nodes until every node waits on an empty mailbox
+    void run()
+    {
+        while (!ready.empty())
+        {
+            std::coroutine_handle<> h = ready.front();
+            ready.pop();
+            h.resume();
+        }
+    }
+};
+
+} // namespace coro
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Compile-time sized variants of the simulators
+// Storage is std::array of Cap entries and word bit sets, runtime N is mapped to the smallest Cap >= N
+
+namespace fixed
+{
+
+inline constexpr int MaxCap = 256;
+
+// Index of the lowest set bit of a non-zero word (std::countr_zero is C++20 only)
+inline int lowestBit(std::uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// Bit set with word access (std::bitset has no portable find-first), loops run over Words
+template <int Bits> struct BitRow
+{
+    static constexpr int Words = (Bits + 63) / 64;
+    std::array<std::uint64_t, Words> w{};
+
+    void set(int i)
+    {
+        w[i >> 6] |= std::uint64_t(1) << (i & 63);
+    }
+    void reset(int i)
+    {
+        w[i >> 6] &= ~(std::uint64_t(1) << (i & 63));
+    }
+    bool test(int i) const
+    {
+        return (w[i >> 6] >> (i & 63)) & 1;
+    }
+    void clear()
+    {
+        w.fill(0);
+    }
+    bool any() const
+    {
+        std::uint64_t acc = 0;
+        for (int k = 0; k < Words; ++k)
+            acc |= w[k];
+        return acc != 0;
+    }
+    bool intersects(const BitRow &o) const
+    {
+        std::uint64_t acc = 0;
+        for (int k = 0; k < Words; ++k)
+            acc |= w[k] & o.w[k];
+        return acc != 0;
+    }
+    // Lowest index set here but not in mask, -1 if none
+    int firstNotIn(const BitRow &mask) const
+    {
+        for (int k = 0; k < Words; ++k)
+        {
+            if (std::uint64_t x = w[k] & ~mask.w[k])
+                return k * 64 + lowestBit(x);
+        }
+        return -1;
+    }
+    // Lowest index set, -1 if none
+    int first() const
+    {
+        for (int k = 0; k < Words; ++k)
+        {
+            if (w[k])
+                return k * 64 + lowestBit(w[k]);
+        }
+        return -1;
+    }
+};
+
+// Iterative DFS over a bit-set graph of n nodes: the next unvisited successor and any
+// back edge into the current path are found a word at a time
+// Returns a node on a cycle (target of the first back edge), -1 if the graph is acyclic
+template <int Cap> int findCycle(const std::array<BitRow<Cap>, Cap> &graph, int n, std::uint64_t &visitedCount)
+{
+    BitRow<Cap> visited, onPath;
+    std::array<int, Cap> stack;
+    for (int s = 0; s < n; ++s)
+    {
+        if (visited.test(s))
+            continue;
+        int top = 0;
+        stack[top++] = s;
+        visited.set(s);
+        onPath.set(s);
+        visitedCount++;
+        while (top > 0)
+        {
+            int u = stack[top - 1];
+            if (graph[u].intersects(onPath))
+            {
+                BitRow<Cap> back = graph[u];
+                for (int k = 0; k < BitRow<Cap>::Words; ++k)
+                    back.w[k] &= onPath.w[k];
+                return back.first();
+            }
+            int v = graph[u].firstNotIn(visited);
+            if (v >= 0)
+            {
+                stack[top++] = v;
+                visited.set(v);
+                onPath.set(v);
+                visitedCount++;
+            }
+            else
+            {
+                onPath.reset(u);
+                top--;
+            }
+        }
+    }
+    return -1;
+}
+
+// Capacity as a type, callers take `[&](auto cap)` and read `decltype(cap)::value`
+template <int Cap> using CapTag = std::integral_constant<int, Cap>;
+
+// Calls f(CapTag<Cap>{}) for the smallest specialization that fits n
+// Returns false when n is larger than every specialization (use the generic path)
+template <class F> bool dispatch(int n, F &&f)
+{
+    if (n <= 8)
+        f(CapTag<8>{});
+    else if (n <= 16)
+        f(CapTag<16>{});
+    else if (n <= 64)
+        f(CapTag<64>{});
+    else if (n <= MaxCap)
+        f(CapTag<MaxCap>{});
+    else
+        return false;
+    return true;
+}
+
+// Capacity that dispatch() picks for n, 0 if none
+inline int capacityFor(int n)
+{
+    int cap = 0;
+    dispatch(n, [&](auto tag) { cap = decltype(tag)::value; });
+    return cap;
+}
+
+// Repetitions requested through SIM_BENCH, 0 when benchmarking is off
+inline int benchRepetitions()
+{
+    const char *reps = std::getenv("SIM_BENCH");
+    return reps ? std::atoi(reps) : 0;
+}
+
+// Average wall time of f in microseconds, std::cout is muted while it runs
+template <class F> double benchMicros(int reps, F &&f)
+{
+    std::cout.setstate(std::ios::badbit);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r)
+    {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::cout.clear();
+    return std::chrono::duration<double, std::micro>(elapsed).count() / reps;
+}
+
+// Prints one line comparing the generic and the fixed-size path
+inline void report(const char *what, int n, int reps, double genericUs, double fixedUs)
+{
+    std::cout << "Benchmark " << what << " (N=" << n << ", Cap=" << capacityFor(n) << ", " << reps
+              << " runs): generic " << genericUs << " us, fixed " << fixedUs << " us, speedup "
+              << (fixedUs > 0 ? genericUs / fixedUs : 0.0) << "x\n";
+}
+
+} // namespace fixed
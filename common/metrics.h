@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Lightweight run metrics shared by the simulators
+// Every thread owns its counters and histograms (no atomics on the hot path),
+// they are merged by name when exported at the end of a run
+//
+// Export is controlled by environment variables:
+//   SIM_METRICS     = json | prometheus
+//   SIM_METRICS_OUT = output file (stdout when unset)
+
+namespace metrics
+{
+
+// HDR-style log-linear histogram: every power of two is split into 2^SubBits linear buckets
+class Histogram
+{
+    static constexpr int SubBits = 3;
+    static constexpr int SubCount = 1 << SubBits;
+    static constexpr int BucketCount = (64 - SubBits + 1) * SubCount;
+
+    std::array<std::uint64_t, BucketCount> counts{};
+    std::uint64_t total = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t minValue = UINT64_MAX;
+    std::uint64_t maxValue = 0;
+
+    static int bucketOf(std::uint64_t v)
+    {
+        if (v < SubCount)
+        {
+            return static_cast<int>(v);
+        }
+        int exp = 63;
+        while ((v >> exp) == 0)
+        {
+            exp--;
+        }
+        int sub = static_cast<int>((v >> (exp - SubBits)) & (SubCount - 1));
+        return (exp - SubBits + 1) * SubCount + sub;
+    }
+
+  public:
+    // Largest value that falls into bucket b
+    static std::uint64_t upperBound(int b)
+    {
+        if (b < SubCount)
+        {
+            return static_cast<std::uint64_t>(b);
+        }
+        int exp = b / SubCount + SubBits - 1;
+        std::uint64_t sub = b % SubCount;
+        std::uint64_t low = (std::uint64_t(SubCount) + sub) << (exp - SubBits);
+        return low + (std::uint64_t(1) << (exp - SubBits)) - 1;
+    }
+
+    void record(std::uint64_t v)
+    {
+        counts[bucketOf(v)]++;
+        total++;
+        sum += v;
+        minValue = std::min(minValue, v);
+        maxValue = std::max(maxValue, v);
+    }
+
+    void merge(const Histogram &other)
+    {
+        for (int b = 0; b < BucketCount; ++b)
+        {
+            counts[b] += other.counts[b];
+        }
+        total += other.total;
+        sum += other.sum;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (0..100)
+    std::uint64_t percentile(double p) const
+    {
+        if (total == 0)
+        {
+            return 0;
+        }
+        // Nearest-rank definition
+        std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * total));
+        rank = std::max<std::uint64_t>(rank, 1);
+        std::uint64_t seen = 0;
+        for (int b = 0; b < BucketCount; ++b)
+        {
+            seen += counts[b];
+            if (seen >= rank)
+            {
+                return std::min(upperBound(b), maxValue);
+            }
+        }
+        return maxValue;
+    }
+
+    std::uint64_t count() const
+    {
+        return total;
+    }
+    std::uint64_t totalSum() const
+    {
+        return sum;
+    }
+    std::uint64_t min() const
+    {
+        return total ? minValue : 0;
+    }
+    std::uint64_t max() const
+    {
+        return maxValue;
+    }
+    std::uint64_t bucketCount(int b) const
+    {
+        return counts[b];
+    }
+    static constexpr int buckets()
+    {
+        return BucketCount;
+    }
+};
+
+struct NamedCounter
+{
+    std::string name;
+    std::uint64_t value = 0;
+};
+
+struct NamedHistogram
+{
+    std::string name;
+    Histogram hist;
+};
+
+// Metrics of one thread, deques keep references handed out by counter()/histogram() stable
+struct Registry
+{
+    std::deque<NamedCounter> counters;
+    std::deque<NamedHistogram> histograms;
+
+    std::uint64_t &counter(const std::string &name)
+    {
+        for (NamedCounter &c : counters)
+        {
+            if (c.name == name)
+            {
+                return c.value;
+            }
+        }
+        counters.push_back({name, 0});
+        return counters.back().value;
+    }
+
+    Histogram &histogram(const std::string &name)
+    {
+        for (NamedHistogram &h : histograms)
+        {
+            if (h.name == name)
+            {
+                return h.hist;
+            }
+        }
+        histograms.push_back({name, Histogram()});
+        return histograms.back().hist;
+    }
+
+    void merge(const Registry &other)
+    {
+        for (const NamedCounter &c : other.counters)
+        {
+            counter(c.name) += c.value;
+        }
+        for (const NamedHistogram &h : other.histograms)
+        {
+            histogram(h.name).merge(h.hist);
+        }
+    }
+};
+
+// All live thread registries plus totals of threads that already exited
+struct Global
+{
+    std::mutex mtx;
+    std::vector<Registry *> live;
+    Registry retired;
+};
+
+inline Global &global()
+{
+    static Global g;
+    return g;
+}
+
+class ThreadRegistry
+{
+    Registry reg;
+
+  public:
+    ThreadRegistry()
+    {
+        std::lock_guard<std::mutex> lock(global().mtx);
+        global().live.push_back(&reg);
+    }
+    ~ThreadRegistry()
+    {
+        std::lock_guard<std::mutex> lock(global().mtx);
+        global().retired.merge(reg);
+        auto &live = global().live;
+        live.erase(std::remove(live.begin(), live.end(), &reg), live.end());
+    }
+    Registry &get()
+    {
+        return reg;
+    }
+};
+
+inline Registry &local()
+{
+    thread_local ThreadRegistry reg;
+    return reg.get();
+}
+
+// Look up once (registration allocates), then bump the returned reference on the hot path
+inline std::uint64_t &counter(const std::string &name)
+{
+    return local().counter(name);
+}
+
+inline Histogram &histogram(const std::string &name)
+{
+    return local().histogram(name);
+}
+
+// Records the lifetime of the scope in nanoseconds
+class ScopedTimer
+{
+    Histogram &hist;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    explicit ScopedTimer(Histogram &h) : hist(h), start(std::chrono::steady_clock::now()) {};
+    ~ScopedTimer()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        hist.record(static_cast<std::uint64_t>(ns.count()));
+    }
+};
+
+inline Registry snapshot()
+{
+    std::lock_guard<std::mutex> lock(global().mtx);
+    Registry all;
+    all.merge(global().retired);
+    for (Registry *r : global().live)
+    {
+        all.merge(*r);
+    }
+    return all;
+}
+
+inline void writeJson(std::ostream &out, const Registry &all)
+{
+    out << "{\n  \"counters\": {";
+    for (std::size_t i = 0; i < all.counters.size(); ++i)
+    {
+        out << (i ? "," : "") << "\n    \"" << all.counters[i].name << "\": " << all.counters[i].value;
+    }
+    out << "\n  },\n  \"histograms\": {";
+    for (std::size_t i = 0; i < all.histograms.size(); ++i)
+    {
+        const Histogram &h = all.histograms[i].hist;
+        out << (i ? "," : "") << "\n    \"" << all.histograms[i].name << "\": {\"count\": " << h.count()
+            << ", \"sum\": " << h.totalSum() << ", \"min\": " << h.min() << ", \"p50\": " << h.percentile(50)
+            << ", \"p90\": " << h.percentile(90) << ", \"p99\": " << h.percentile(99) << ", \"max\": " << h.max()
+            << "}";
+    }
+    out << "\n  }\n}\n";
+}
+
+inline void writePrometheus(std::ostream &out, const Registry &all)
+{
+    for (const NamedCounter &c : all.counters)
+    {
+        out << "# TYPE " << c.name << " counter\n" << c.name << " " << c.value << "\n";
+    }
+    for (const NamedHistogram &nh : all.histograms)
+    {
+        const Histogram &h = nh.hist;
+        out << "# TYPE " << nh.name << " histogram\n";
+        std::uint64_t cumulative = 0;
+        for (int b = 0; b < Histogram::buckets(); ++b)
+        {
+            if (h.bucketCount(b) == 0)
+            {
+                continue;
+            }
+            cumulative += h.bucketCount(b);
+            out << nh.name << "_bucket{le=\"" << Histogram::upperBound(b) << "\"} " << cumulative << "\n";
+        }
+        out << nh.name << "_bucket{le=\"+Inf\"} " << h.count() << "\n";
+        out << nh.name << "_sum " << h.totalSum() << "\n" << nh.name << "_count " << h.count() << "\n";
+    }
+}
+
+// Writes 'all' in the format chosen by SIM_METRICS
+inline void exportFromEnv(const Registry &all)
+{
+    const char *format = std::getenv("SIM_METRICS");
+    if (format == nullptr)
+    {
+        return;
+    }
+    std::string fmt = format;
+    if (fmt != "json" && fmt != "prometheus")
+    {
+        std::cerr << "Unknown SIM_METRICS format: " << fmt << "\n";
+        return;
+    }
+
+    std::ofstream file;
+    const char *path = std::getenv("SIM_METRICS_OUT");
+    if (path != nullptr)
+    {
+        file.open(path);
+        if (!file.is_open())
+        {
+            std::cerr << "Cannot open metrics file " << path << "\n";
+            return;
+        }
+    }
+    std::ostream &out = path ? static_cast<std::ostream &>(file) : std::cout;
+
+    if (fmt == "json")
+    {
+        writeJson(out, all);
+    }
+    else
+    {
+        writePrometheus(out, all);
+    }
+}
+
+// Call at the end of main: writes all metrics recorded so far
+// Take a snapshot() earlier and pass it instead to leave out later work (benchmark repetitions)
+inline void exportFromEnv()
+{
+    exportFromEnv(snapshot());
+}
+
+} // namespace metrics
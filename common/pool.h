@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Preallocated storage shared by the simulators
+// All buffers are sized up front, so steady-state events do not touch the heap
+
+// Bump allocator over one fixed buffer, everything is released at once by reset()
+class Arena
+{
+    std::unique_ptr<std::byte[]> buffer;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+
+  public:
+    Arena() = default;
+    explicit Arena(std::size_t bytes) : buffer(new std::byte[bytes]), capacity(bytes) {};
+
+    void *allocate(std::size_t bytes, std::size_t align)
+    {
+        std::size_t start = (used + align - 1) / align * align;
+        if (start + bytes > capacity)
+        {
+            throw std::bad_alloc();
+        }
+        used = start + bytes;
+        return buffer.get() + start;
+    }
+
+    // Objects must be trivially destructible, their memory is never freed one by one
+    template <class T, class... Args> T *create(Args &&...args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    void reset()
+    {
+        used = 0;
+    }
+};
+
+// Fixed number of T slots recycled through an intrusive free list
+template <class T> class ObjectPool
+{
+    union Slot
+    {
+        Slot *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    Slot *freeList = nullptr;
+
+  public:
+    ObjectPool() = default;
+    explicit ObjectPool(std::size_t capacity)
+    {
+        reserve(capacity);
+    }
+
+    // Must be called before any create(), previously returned objects become invalid
+    void reserve(std::size_t capacity)
+    {
+        slots.reset(new Slot[capacity]);
+        freeList = nullptr;
+        for (std::size_t i = capacity; i-- > 0;)
+        {
+            slots[i].next = freeList;
+            freeList = &slots[i];
+        }
+    }
+
+    template <class... Args> T *create(Args &&...args)
+    {
+        if (freeList == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        Slot *s = freeList;
+        freeList = s->next;
+        return new (s->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T *obj)
+    {
+        obj->~T();
+        Slot *s = reinterpret_cast<Slot *>(obj);
+        s->next = freeList;
+        freeList = s;
+    }
+};
+
+// FIFO over a power-of-two ring buffer, T must be default constructible
+// Capacity only grows when the high-water mark is exceeded
+template <class T> class RingQueue
+{
+    std::vector<T> buf = std::vector<T>(1);
+    std::size_t head = 0;
+    std::size_t count = 0;
+
+    void grow(std::size_t capacity)
+    {
+        std::vector<T> bigger(capacity);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bigger[i] = std::move((*this)[i]);
+        }
+        buf.swap(bigger);
+        head = 0;
+    }
+
+  public:
+    void reserve(std::size_t n)
+    {
+        std::size_t capacity = buf.size();
+        while (capacity < n)
+        {
+            capacity *= 2;
+        }
+        if (capacity > buf.size())
+        {
+            grow(capacity);
+        }
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+    std::size_t size() const
+    {
+        return count;
+    }
+
+    // i-th element from the front, lets callers print the queue without copying it
+    T &operator[](std::size_t i)
+    {
+        return buf[(head + i) & (buf.size() - 1)];
+    }
+    const T &operator[](std::size_t i) const
+    {
+        return buf[(head + i) & (buf.size() - 1)];
+    }
+
+    T &front()
+    {
+        return buf[head];
+    }
+    const T &front() const
+    {
+        return buf[head];
+    }
+
+    void push(const T &value)
+    {
+        if (count == buf.size())
+        {
+            grow(buf.size() * 2);
+        }
+        (*this)[count++] = value;
+    }
+
+    template <class... Args> void emplace(Args &&...args)
+    {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    void pop()
+    {
+        head = (head + 1) & (buf.size() - 1);
+        count--;
+    }
+
+    void clear()
+    {
+        head = count = 0;
+    }
+};
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Flat binary checkpoints of simulator state
+//
+// Layout (native byte order, every offset is from the start of the file):
+//   Header | Section[MaxSections] | section data, each array 8-byte aligned
+// Sections are plain arrays of trivially copyable values tagged with a four-character code,
+// there are no pointers, so a mapped file is used in place without parsing
+//
+// Controlled by environment variables:
+//   SIM_SNAPSHOT       = file written at the end of the run
+//   SIM_SNAPSHOT_EVERY = also write it after every k operations (mid-run checkpoint)
+//   SIM_RESTORE        = resume from this file instead of reading the initial state
+
+namespace snapshot
+{
+
+inline constexpr std::uint32_t Version = 1;
+inline constexpr std::uint32_t ByteOrderMark = 0x01020304;
+inline constexpr int MaxSections = 16;
+
+// Four-character code, e.g. code("wfgE")
+constexpr std::uint32_t code(const char (&s)[5])
+{
+    return std::uint32_t(std::uint8_t(s[0])) | std::uint32_t(std::uint8_t(s[1])) << 8 |
+           std::uint32_t(std::uint8_t(s[2])) << 16 | std::uint32_t(std::uint8_t(s[3])) << 24;
+}
+
+struct Header
+{
+    char magic[8];            // "SIMSNAP\0"
+    std::uint32_t version;    // format version, bumped on incompatible changes
+    std::uint32_t byteOrder;  // ByteOrderMark as written by the producer
+    std::uint32_t kind;       // which simulator wrote the file
+    std::uint32_t sections;   // used entries of the section table
+    std::uint64_t totalBytes; // file size, catches truncated files
+};
+
+struct Section
+{
+    std::uint32_t tag;      // four-character code
+    std::uint32_t elemSize; // sizeof one element
+    std::uint64_t offset;   // start of the array
+    std::uint64_t count;    // number of elements
+};
+
+inline constexpr std::uint64_t DataStart = sizeof(Header) + MaxSections * sizeof(Section);
+
+// Read-only array inside a mapping (std::span without needing C++20)
+template <class T> struct View
+{
+    const T *data = nullptr;
+    std::size_t count = 0;
+
+    std::size_t size() const
+    {
+        return count;
+    }
+    const T &operator[](std::size_t i) const
+    {
+        return data[i];
+    }
+    const T *begin() const
+    {
+        return data;
+    }
+    const T *end() const
+    {
+        return data + count;
+    }
+};
+
+// Streams sections into "<path>.tmp" and renames it over path on commit(),
+// so a checkpoint interrupted mid-write never replaces the previous one
+// Uses only the C stdio buffer, taking a checkpoint does not touch operator new
+class Writer
+{
+    std::array<char, 4096> target{};
+    std::array<char, 4096> temp{};
+    std::FILE *file = nullptr;
+    std::uint32_t kind;
+    std::array<Section, MaxSections> table{};
+    int used = 0;
+    std::uint64_t offset = DataStart;
+    bool open = false; // a streamed section is in progress
+
+    void put(const void *data, std::size_t bytes)
+    {
+        if (bytes != 0 && std::fwrite(data, 1, bytes, file) != bytes)
+        {
+            throw std::runtime_error("Cannot write snapshot");
+        }
+        offset += bytes;
+    }
+
+    void pad()
+    {
+        static const char zeros[8] = {};
+        put(zeros, static_cast<std::size_t>((8 - offset % 8) % 8));
+    }
+
+  public:
+    Writer(const char *path, std::uint32_t kind) : kind(kind)
+    {
+        if (std::snprintf(target.data(), target.size(), "%s", path) >= static_cast<int>(target.size()) ||
+            std::snprintf(temp.data(), temp.size(), "%s.tmp", path) >= static_cast<int>(temp.size()))
+        {
+            throw std::runtime_error("Snapshot path too long");
+        }
+        file = std::fopen(temp.data(), "wb");
+        if (file == nullptr)
+        {
+            throw std::runtime_error("Cannot create snapshot file");
+        }
+        std::array<char, DataStart> placeholder{};
+        if (std::fwrite(placeholder.data(), 1, placeholder.size(), file) != placeholder.size())
+        {
+            throw std::runtime_error("Cannot write snapshot");
+        }
+    }
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+    ~Writer()
+    {
+        if (file != nullptr)
+        {
+            std::fclose(file);
+            std::remove(temp.data());
+        }
+    }
+
+    // Starts a section whose elements are appended one by one with value()
+    template <class T> void begin(std::uint32_t tag)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (used == MaxSections || open)
+        {
+            throw std::logic_error("Snapshot section table misuse");
+        }
+        pad();
+        table[used] = Section{tag, static_cast<std::uint32_t>(sizeof(T)), offset, 0};
+        open = true;
+    }
+
+    template <class T> void value(const T &v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put(&v, sizeof(T));
+        table[used].count++;
+    }
+
+    void end()
+    {
+        open = false;
+        used++;
+    }
+
+    // Whole contiguous array as one section
+    template <class T> void array(std::uint32_t tag, const T *data, std::size_t count)
+    {
+        begin<T>(tag);
+        put(data, count * sizeof(T));
+        table[used].count = count;
+        end();
+    }
+
+    // Single value as a one-element section
+    template <class T> void scalar(std::uint32_t tag, const T &v)
+    {
+        array(tag, &v, 1);
+    }
+
+    void commit()
+    {
+        if (open)
+        {
+            throw std::logic_error("Snapshot section left open");
+        }
+        pad();
+        Header header{};
+        std::memcpy(header.magic, "SIMSNAP", 8);
+        header.version = Version;
+        header.byteOrder = ByteOrderMark;
+        header.kind = kind;
+        header.sections = static_cast<std::uint32_t>(used);
+        header.totalBytes = offset;
+        if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1 ||
+            std::fwrite(table.data(), sizeof(Section), table.size(), file) != table.size())
+        {
+            throw std::runtime_error("Cannot write snapshot");
+        }
+        int closed = std::fclose(file);
+        file = nullptr;
+#ifdef _WIN32
+        bool renamed = MoveFileExA(temp.data(), target.data(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        bool renamed = std::rename(temp.data(), target.data()) == 0;
+#endif
+        if (closed != 0 || !renamed)
+        {
+            std::remove(temp.data());
+            throw std::runtime_error("Cannot finish snapshot");
+        }
+    }
+};
+
+// Read-only memory mapping of a snapshot, sections are returned as views into the mapping
+class Mapping
+{
+    const std::byte *base = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapHandle = nullptr;
+#endif
+
+    void unmap()
+    {
+#ifdef _WIN32
+        if (base != nullptr)
+            UnmapViewOfFile(base);
+        if (mapHandle != nullptr)
+            CloseHandle(mapHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(fileHandle);
+#else
+        if (base != nullptr)
+            munmap(const_cast<std::byte *>(base), length);
+#endif
+        base = nullptr;
+    }
+
+    const Header &header() const
+    {
+        return *reinterpret_cast<const Header *>(base);
+    }
+
+    const Section *find(std::uint32_t tag) const
+    {
+        const Section *table = reinterpret_cast<const Section *>(base + sizeof(Header));
+        for (std::uint32_t i = 0; i < header().sections; ++i)
+        {
+            if (table[i].tag == tag)
+            {
+                return &table[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void validate(std::uint32_t kind) const
+    {
+        if (length < DataStart)
+            throw std::runtime_error("Snapshot file is truncated");
+        const Header &h = header();
+        if (std::memcmp(h.magic, "SIMSNAP", 8) != 0)
+            throw std::runtime_error("Not a snapshot file");
+        if (h.version != Version)
+            throw std::runtime_error("Unsupported snapshot version " + std::to_string(h.version));
+        if (h.byteOrder != ByteOrderMark)
+            throw std::runtime_error("Snapshot was written with a different byte order");
+        if (h.kind != kind)
+            throw std::runtime_error("Snapshot belongs to another simulator");
+        if (h.totalBytes != length || h.sections > MaxSections)
+            throw std::runtime_error("Snapshot file is corrupted");
+
+        const Section *table = reinterpret_cast<const Section *>(base + sizeof(Header));
+        for (std::uint32_t i = 0; i < h.sections; ++i)
+        {
+            const Section &s = table[i];
+            if (s.offset % 8 != 0 || s.offset < DataStart || s.offset > length || s.elemSize == 0 ||
+                s.count > (length - s.offset) / s.elemSize)
+            {
+                throw std::runtime_error("Snapshot section out of bounds");
+            }
+        }
+    }
+
+  public:
+    Mapping(const char *path, std::uint32_t kind)
+    {
+#ifdef _WIN32
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                 nullptr);
+        LARGE_INTEGER size;
+        if (fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(fileHandle, &size))
+        {
+            unmap();
+            throw std::runtime_error(std::string("Cannot open snapshot ") + path);
+        }
+        length = static_cast<std::size_t>(size.QuadPart);
+        mapHandle = length ? CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        base = mapHandle ? static_cast<const std::byte *>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+        int fd = ::open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error(std::string("Cannot open snapshot ") + path);
+        }
+        length = static_cast<std::size_t>(st.st_size);
+        void *p = length ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd); // the mapping stays valid
+        base = p == MAP_FAILED ? nullptr : static_cast<const std::byte *>(p);
+#endif
+        if (base == nullptr)
+        {
+            unmap();
+            throw std::runtime_error(std::string("Cannot map snapshot ") + path);
+        }
+        try
+        {
+            validate(kind);
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+    ~Mapping()
+    {
+        unmap();
+    }
+
+    // Section as an array of T, throws if it is missing or was written with another element type
+    template <class T> View<T> array(std::uint32_t tag) const
+    {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 8);
+        const Section *s = find(tag);
+        if (s == nullptr || s->elemSize != sizeof(T))
+        {
+            throw std::runtime_error("Snapshot section missing or of the wrong type");
+        }
+        return View<T>{reinterpret_cast<const T *>(base + s->offset), static_cast<std::size_t>(s->count)};
+    }
+
+    template <class T> const T &scalar(std::uint32_t tag) const
+    {
+        View<T> s = array<T>(tag);
+        if (s.size() != 1)
+        {
+            throw std::runtime_error("Snapshot scalar has the wrong size");
+        }
+        return s[0];
+    }
+};
+
+// Checkpoint settings of one run, read once from the environment
+struct Checkpoint
+{
+    const char *savePath = nullptr;    // SIM_SNAPSHOT
+    const char *restorePath = nullptr; // SIM_RESTORE
+    long every = 0;                    // SIM_SNAPSHOT_EVERY, 0 = only at the end
+
+    static Checkpoint fromEnv()
+    {
+        Checkpoint cp;
+        cp.savePath = std::getenv("SIM_SNAPSHOT");
+        cp.restorePath = std::getenv("SIM_RESTORE");
+        const char *every = std::getenv("SIM_SNAPSHOT_EVERY");
+        cp.every = every ? std::atol(every) : 0;
+        return cp;
+    }
+
+    // Whether a mid-run checkpoint is due after `done` operations
+    bool due(std::size_t done) const
+    {
+        return savePath != nullptr && every > 0 && done % static_cast<std::size_t>(every) == 0;
+    }
+};
+
+} // namespace snapshot
@@ -1,7 +1,16 @@
+#include "../../common/metrics.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
 
+// Run metrics, exported at the end of main
+std::uint64_t &sweepPasses = metrics::counter("graph_reachability_sweeps_total");
+std::uint64_t &nodesReached = metrics::counter("graph_nodes_reached_total");
+metrics::Histogram &candidateLatency = metrics::histogram("graph_good_candidate_ns");
+std::uint64_t &treeRepairs = metrics::counter("graph_tree_repairs_total");
+std::uint64_t &fullRebuilds = metrics::counter("graph_full_rebuilds_total");
+metrics::Histogram &updateLatency = metrics::histogram("graph_edge_update_ns");
+
 std::vector<std::vector<int>> readAdjacencyMatrix(const std::string &filename)
 {
     std::ifstream file(filename);
@@ -28,6 +37,7 @@ std::vector<std::vector<int>> readAdjacencyMatrix(const std::string &filename)
 bool goodCandidate(std::size_t startNode, const std::vector<std::vector<int>> &adjacencyMatrix)
 {
     const std::size_t N = adjacencyMatrix.size();
+    metrics::ScopedTimer timer(candidateLatency);
 
     if (startNode >= N)
     {
@@ -52,6 +62,7 @@ bool goodCandidate(std::size_t startNode, const std::vector<std::vector<int>> &a
     while (ok)
     {
         ok = false;
+        sweepPasses++;
         for (std::size_t i = 0; i < N; ++i)
         {
             if (visited[i] == true)
@@ -61,6 +72,7 @@ bool goodCandidate(std::size_t startNode, const std::vector<std::vector<int>> &a
                     if ((adjacencyMatrix[i][j] == 1) && (visited[j] == false))
                     {
                         visited[j] = true; // Possible connection
+                        nodesReached++;
                         ok = true;         // Size changed -> keep going
                     }
                 }
@@ -88,6 +100,302 @@ void checkAllNodes(const std::vector<std::vector<int>> adjacencyMatrix)
     }
 }
 
+// Maintains the "Good" nodes (nodes that reach every node) while edges come and go
+// All Good nodes reach each other, so with one Good node as root:
+//   outParent - spanning tree of edges from root, proves that root reaches everyone
+//   inParent  - spanning tree of edges into root, its nodes are exactly the Good ones
+// Updates only touch the subtree hanging below a changed tree edge, a full rebuild
+// happens only when the root itself stops being Good
+// With no Good node a node that no other node points at (a source) is the only possible one:
+// two sources rule out any Good node, a single source's reach is grown as edges arrive,
+// and only a graph without sources (every node on some cycle) is rebuilt on each insertion
+class DynamicReachability
+{
+    int N;
+    std::vector<std::vector<char>> adj;    // adjacency matrix
+    std::vector<std::vector<int>> out, in; // adjacency lists
+    std::vector<std::vector<int>> posOut;  // posOut[u][v] = index of v in out[u]
+    std::vector<std::vector<int>> posIn;   // posIn[v][u] = index of u in in[v]
+    int root = -1;                         // a Good node, -1 if there is none
+    std::vector<int> outParent, inParent;  // -1 = not in tree, root points to itself
+    std::vector<int> work;                 // scratch queue
+    int goodCount = 0;
+    int sources = 0;    // nodes without an edge from another node
+    int candidate = -1; // source whose reach outParent holds while root == -1
+    int reached = 0;    // size of that reach
+
+    static void removeAt(std::vector<int> &list, std::vector<std::vector<int>> &pos, int owner, int idx)
+    {
+        int moved = list.back();
+        list[idx] = moved;
+        pos[owner][moved] = idx;
+        list.pop_back();
+    }
+
+    bool isSource(int v) const
+    {
+        return static_cast<int>(in[v].size()) == adj[v][v];
+    }
+
+    // BFS from 'from' along 'edges', filling parent, returns number of nodes reached
+    int grow(int from, const std::vector<std::vector<int>> &edges, std::vector<int> &parent)
+    {
+        std::fill(parent.begin(), parent.end(), -1);
+        parent[from] = from;
+        work.assign(1, from);
+        return spread(edges, parent);
+    }
+
+    // Continue the BFS from the nodes already in work, returns number of nodes added
+    int spread(const std::vector<std::vector<int>> &edges, std::vector<int> &parent)
+    {
+        for (std::size_t h = 0; h < work.size(); ++h)
+        {
+            int x = work[h];
+            for (int y : edges[x])
+            {
+                if (parent[y] == -1)
+                {
+                    parent[y] = x;
+                    work.push_back(y);
+                }
+            }
+        }
+        return static_cast<int>(work.size());
+    }
+
+    void rebuild()
+    {
+        fullRebuilds++;
+        root = -1;
+        candidate = -1;
+        goodCount = 0;
+        std::fill(inParent.begin(), inParent.end(), -1);
+        if (N == 0)
+            return;
+
+        // Last node to finish a DFS over the whole graph is the only possible Good candidate
+        std::vector<char> seen(N, 0);
+        std::vector<std::pair<int, std::size_t>> stack;
+        int candidate = 0;
+        for (int s = 0; s < N; ++s)
+        {
+            if (seen[s])
+                continue;
+            seen[s] = 1;
+            stack.emplace_back(s, 0);
+            while (!stack.empty())
+            {
+                auto &[x, next] = stack.back();
+                if (next < out[x].size())
+                {
+                    int y = out[x][next++];
+                    if (!seen[y])
+                    {
+                        seen[y] = 1;
+                        stack.emplace_back(y, 0);
+                    }
+                }
+                else
+                {
+                    candidate = x;
+                    stack.pop_back();
+                }
+            }
+        }
+
+        if (grow(candidate, out, outParent) < N)
+            return;
+        root = candidate;
+        goodCount = grow(root, in, inParent);
+    }
+
+    // No Good node is known and u->v was just added
+    void seekGood(int u, int v)
+    {
+        if (sources >= 2)
+            return;
+        if (sources == 0)
+        {
+            rebuild();
+            return;
+        }
+
+        // Reach of the single source only grows while edges are added
+        if (candidate == -1 || !isSource(candidate))
+        {
+            candidate = 0;
+            while (!isSource(candidate))
+                ++candidate;
+            reached = grow(candidate, out, outParent);
+        }
+        else if (outParent[u] != -1 && outParent[v] == -1)
+        {
+            outParent[v] = u;
+            work.assign(1, v);
+            reached += spread(out, outParent);
+        }
+        if (reached < N)
+            return;
+        root = candidate;
+        candidate = -1;
+        goodCount = grow(root, in, inParent);
+    }
+
+    // Reattach the subtree of 'cut' after its tree edge disappeared
+    // succ/pred are the tree direction and its reverse; returns number of nodes left detached
+    int repair(int cut, const std::vector<std::vector<int>> &succ, const std::vector<std::vector<int>> &pred,
+               std::vector<int> &parent)
+    {
+        treeRepairs++;
+        // Collect the detached subtree: children of x are successors that point back at x
+        work.assign(1, cut);
+        for (std::size_t h = 0; h < work.size(); ++h)
+        {
+            int x = work[h];
+            for (int y : succ[x])
+            {
+                if (parent[y] == x && y != x)
+                    work.push_back(y);
+            }
+        }
+        for (int x : work)
+            parent[x] = -1;
+
+        // Nodes with an edge from the attached part come back first, then spread along succ
+        std::vector<int> detached;
+        detached.swap(work);
+        for (int x : detached)
+        {
+            for (int p : pred[x])
+            {
+                if (parent[p] != -1)
+                {
+                    parent[x] = p;
+                    work.push_back(x);
+                    break;
+                }
+            }
+        }
+        for (std::size_t h = 0; h < work.size(); ++h)
+        {
+            int x = work[h];
+            for (int y : succ[x])
+            {
+                if (parent[y] == -1)
+                {
+                    parent[y] = x;
+                    work.push_back(y);
+                }
+            }
+        }
+        return static_cast<int>(detached.size() - work.size());
+    }
+
+  public:
+    DynamicReachability(const std::vector<std::vector<int>> &matrix)
+        : N(static_cast<int>(matrix.size())), adj(N, std::vector<char>(N, 0)), out(N), in(N),
+          posOut(N, std::vector<int>(N, -1)), posIn(N, std::vector<int>(N, -1)), outParent(N, -1), inParent(N, -1)
+    {
+        for (int u = 0; u < N; ++u)
+        {
+            for (int v = 0; v < N; ++v)
+            {
+                if (matrix[u][v] == 1)
+                {
+                    adj[u][v] = 1;
+                    posOut[u][v] = static_cast<int>(out[u].size());
+                    out[u].push_back(v);
+                    posIn[v][u] = static_cast<int>(in[v].size());
+                    in[v].push_back(u);
+                }
+            }
+        }
+        for (int v = 0; v < N; ++v)
+            sources += isSource(v);
+        rebuild();
+    }
+
+    bool isGood(int v) const
+    {
+        return root != -1 && inParent[v] != -1;
+    }
+
+    int countGood() const
+    {
+        return goodCount;
+    }
+
+    void insertEdge(int u, int v)
+    {
+        if (adj[u][v])
+            return;
+        adj[u][v] = 1;
+        posOut[u][v] = static_cast<int>(out[u].size());
+        out[u].push_back(v);
+        posIn[v][u] = static_cast<int>(in[v].size());
+        in[v].push_back(u);
+        if (u != v && static_cast<int>(in[v].size()) == 1 + adj[v][v])
+            sources--;
+
+        if (root == -1)
+        {
+            seekGood(u, v);
+            return;
+        }
+        // Insertions never break reachability, u becomes Good iff v is,
+        // together with every non-Good node that reaches u
+        if (inParent[v] == -1 || inParent[u] != -1)
+            return;
+        inParent[u] = v;
+        work.assign(1, u);
+        for (std::size_t h = 0; h < work.size(); ++h)
+        {
+            for (int p : in[work[h]])
+            {
+                if (inParent[p] == -1)
+                {
+                    inParent[p] = work[h];
+                    work.push_back(p);
+                }
+            }
+        }
+        goodCount += static_cast<int>(work.size());
+    }
+
+    void deleteEdge(int u, int v)
+    {
+        if (!adj[u][v])
+            return;
+        adj[u][v] = 0;
+        removeAt(out[u], posOut, u, posOut[u][v]);
+        removeAt(in[v], posIn, v, posIn[v][u]);
+        posOut[u][v] = posIn[v][u] = -1;
+        if (u != v && isSource(v))
+            sources++;
+
+        // Deletions never create Good nodes, only tree edges matter
+        if (root == -1)
+        {
+            // the candidate's reach may have shrunk, regrow it on the next insertion
+            candidate = -1;
+            return;
+        }
+        if (u == v)
+            return;
+        if (outParent[v] == u && repair(v, out, in, outParent) > 0)
+        {
+            // root lost part of the graph, another old Good node may still reach it
+            rebuild();
+            return;
+        }
+        if (inParent[u] == v)
+        {
+            goodCount -= repair(u, in, out, inParent);
+        }
+    }
+};
+
 int main()
 {
     std::string filename;
@@ -96,5 +404,40 @@ int main()
     std::vector<std::vector<int>> M = readAdjacencyMatrix(filename);
     checkAllNodes(M);
 
+    // Topology changes: keep answering without rescanning the whole graph
+    DynamicReachability live(M);
+    char op;
+    std::cout << "Enter edge updates ('+ u v' add, '- u v' remove, 'q' quit):\n";
+    while (std::cin >> op && op != 'q')
+    {
+        if (op != '+' && op != '-')
+        {
+            std::cerr << "Invalid operation: " << op << "\n";
+            break;
+        }
+        int u, v;
+        std::cin >> u >> v;
+        if (!std::cin || u < 0 || v < 0 || u >= static_cast<int>(M.size()) || v >= static_cast<int>(M.size()))
+        {
+            std::cerr << "Invalid edge.\n";
+            break;
+        }
+        {
+            metrics::ScopedTimer timer(updateLatency);
+            if (op == '+')
+                live.insertEdge(u, v);
+            else
+                live.deleteEdge(u, v);
+        }
+        std::cout << "Good nodes (" << live.countGood() << "):";
+        for (int x = 0; x < static_cast<int>(M.size()); ++x)
+        {
+            if (live.isGood(x))
+                std::cout << " " << x;
+        }
+        std::cout << "\n";
+    }
+
+    metrics::exportFromEnv();
     return 0;
 }